@@ -0,0 +1,235 @@
+#include "autosave.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_thread.h>
+#include <SDL3/SDL_timer.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_filesystem.h>
+
+#include "rle.h"
+#include "core.h"
+#include "trace.h"
+#include "profile.h"
+
+#define AUTOSAVE_MAGIC 0x56534341u // "ACSV"
+#define AUTOSAVE_VERSION 1
+
+typedef struct autosave_header_t autosave_header_t;
+struct autosave_header_t {
+    Uint32 magic;
+    Uint32 version;
+    Uint64 state_size;
+};
+
+// The frame thread only serializes into a preallocated buffer, compression and the write to a
+// temporary file that then replaces the save happen on a worker thread.
+static struct {
+    bool initialized;
+    char temp_path[260];
+    Uint8 *state;
+    size_t state_size;
+    size_t state_capacity;
+    Uint8 *encoded;
+    size_t encoded_capacity;
+    Uint64 serialize_ns;
+    SDL_Thread *thread;
+    SDL_Mutex *lock;
+    SDL_Condition *cond;
+    bool pending;
+    bool quit;
+} g_autosave;
+
+static int  Autosave_Worker(void *userdata);
+static bool Autosave_Reserve(size_t size);
+static bool Autosave_Write(void);
+
+bool Autosave_Init(void)
+{
+    Autosave_Free();
+
+    SDL_snprintf(g_autosave.temp_path, sizeof(g_autosave.temp_path), "%s.tmp", Profile_GetAutosavePath());
+    if (!Autosave_Reserve(Core_GetStateSize())) return false;
+    if (!(g_autosave.lock = SDL_CreateMutex())) return false;
+    if (!(g_autosave.cond = SDL_CreateCondition())) return false;
+    if (!(g_autosave.thread = SDL_CreateThread(Autosave_Worker, "autosave", 0))) return false;
+
+    g_autosave.initialized = true;
+    return true;
+}
+
+void Autosave_Free(void)
+{
+    if (g_autosave.thread)
+    {
+        SDL_LockMutex(g_autosave.lock);
+        g_autosave.quit = true;
+        SDL_SignalCondition(g_autosave.cond);
+        SDL_UnlockMutex(g_autosave.lock);
+        SDL_WaitThread(g_autosave.thread, 0);
+    }
+
+    SDL_DestroyCondition(g_autosave.cond);
+    SDL_DestroyMutex(g_autosave.lock);
+    SDL_free(g_autosave.state);
+    SDL_free(g_autosave.encoded);
+    SDL_memset(&g_autosave, 0, sizeof(g_autosave));
+}
+
+bool Autosave_Load(const char *path)
+{
+    SDL_assert_release(g_autosave.initialized);
+
+    size_t size = 0;
+    Trace_Begin("SDL_LoadFile");
+    Uint8 *file = SDL_LoadFile(path, &size);
+    Trace_End("SDL_LoadFile");
+    if (!file)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to read save file");
+        return false;
+    }
+
+    // Saves written before compression was added are raw retro_serialize() output.
+    const void *state = file;
+    autosave_header_t header = { 0 };
+    if (size >= sizeof(header)) SDL_memcpy(&header, file, sizeof(header));
+
+    if (header.magic == AUTOSAVE_MAGIC)
+    {
+        if (header.version != AUTOSAVE_VERSION || !Autosave_Reserve(header.state_size) ||
+            !Rle_Decode(file + sizeof(header), size - sizeof(header), g_autosave.state, header.state_size, false))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "save file \"%s\" is corrupted", path);
+            SDL_free(file);
+            return false;
+        }
+        state = g_autosave.state;
+        size = header.state_size;
+    }
+
+    if (!Core_UnserializeState(state, size))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "retro_unserialize() failed");
+        SDL_free(file);
+        return false;
+    }
+
+    SDL_Log("Loaded save");
+    SDL_free(file);
+    return true;
+}
+
+bool Autosave_Save(bool wait)
+{
+    if (!g_autosave.initialized)
+        return false;
+
+    // The state buffer is still being read by the worker while a write is pending.
+    SDL_LockMutex(g_autosave.lock);
+    while (wait && g_autosave.pending)
+        SDL_WaitCondition(g_autosave.cond, g_autosave.lock);
+    bool busy = g_autosave.pending;
+    SDL_UnlockMutex(g_autosave.lock);
+
+    if (busy)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "previous autosave is still being written");
+        return false;
+    }
+
+    Uint64 t0 = SDL_GetTicksNS();
+
+    size_t size = Core_GetStateSize();
+    if (!Autosave_Reserve(size) || !Core_SerializeState(g_autosave.state, size))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "retro_serialize() failed");
+        return false;
+    }
+
+    SDL_LockMutex(g_autosave.lock);
+    g_autosave.state_size = size;
+    g_autosave.serialize_ns = SDL_GetTicksNS() - t0;
+    g_autosave.pending = true;
+    SDL_SignalCondition(g_autosave.cond);
+    SDL_UnlockMutex(g_autosave.lock);
+    return true;
+}
+
+int Autosave_Worker(void *userdata)
+{
+    Trace_NameThread("autosave");
+
+    SDL_LockMutex(g_autosave.lock);
+    while (true)
+    {
+        while (!g_autosave.pending && !g_autosave.quit)
+            SDL_WaitCondition(g_autosave.cond, g_autosave.lock);
+
+        // A save requested right before quitting is still written out.
+        if (!g_autosave.pending)
+            break;
+
+        SDL_UnlockMutex(g_autosave.lock);
+        Trace_Begin("Autosave_Write");
+        Autosave_Write();
+        Trace_End("Autosave_Write");
+        SDL_LockMutex(g_autosave.lock);
+        g_autosave.pending = false;
+        SDL_BroadcastCondition(g_autosave.cond);
+    }
+    SDL_UnlockMutex(g_autosave.lock);
+    return 0;
+}
+
+bool Autosave_Reserve(size_t size)
+{
+    if (size <= g_autosave.state_capacity)
+        return true;
+
+    SDL_free(g_autosave.state);
+    SDL_free(g_autosave.encoded);
+    g_autosave.state_capacity = size;
+    g_autosave.state = SDL_malloc(size);
+    g_autosave.encoded_capacity = Rle_GetMaxEncodedSize(size);
+    g_autosave.encoded = SDL_malloc(g_autosave.encoded_capacity);
+
+    if (!g_autosave.state || !g_autosave.encoded)
+    {
+        g_autosave.state_capacity = g_autosave.encoded_capacity = 0;
+        return SDL_SetError("failed to allocate %zu KB for autosave", size / 1024);
+    }
+    return true;
+}
+
+bool Autosave_Write(void)
+{
+    const char *path = Profile_GetAutosavePath();
+    Uint64 t0 = SDL_GetTicksNS();
+
+    size_t size = Rle_Encode(g_autosave.state, 0, g_autosave.state_size, g_autosave.encoded, g_autosave.encoded_capacity);
+    autosave_header_t header = { AUTOSAVE_MAGIC, AUTOSAVE_VERSION, g_autosave.state_size };
+
+    SDL_IOStream *io = SDL_IOFromFile(g_autosave.temp_path, "wb");
+    bool ok = io && size;
+    ok = ok && SDL_WriteIO(io, &header, sizeof(header)) == sizeof(header);
+    ok = ok && SDL_WriteIO(io, g_autosave.encoded, size) == size;
+    ok = (io) ? (SDL_CloseIO(io) && ok) : (false);
+    ok = ok && SDL_RenamePath(g_autosave.temp_path, path);
+
+    if (!ok)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to write save state: %s", SDL_GetError());
+        SDL_RemovePath(g_autosave.temp_path);
+        return false;
+    }
+
+    SDL_Log(
+        "Saved state to \"%s\" (%zu KB, %.2f ms on frame thread, %.2f ms in background)",
+        path,
+        (sizeof(header) + size) / 1024,
+        g_autosave.serialize_ns / 1e6,
+        (SDL_GetTicksNS() - t0) / 1e6
+    );
+    return true;
+}
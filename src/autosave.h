@@ -0,0 +1,9 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+bool Autosave_Init(void);
+void Autosave_Free(void);
+
+bool Autosave_Load(const char *path);
+bool Autosave_Save(bool wait);
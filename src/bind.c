@@ -0,0 +1,145 @@
+#include "bind.h"
+#include "profile.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_log.h>
+
+#define BIND_MOUSE_BUTTONS 5
+#define BIND_MOUSE_BASE SDL_SCANCODE_COUNT
+
+typedef struct bind_default_t bind_default_t;
+struct bind_default_t {
+    int input;
+    bind_action_t action;
+};
+
+static const char *g_bind_action_names[BIND_ACTION_COUNT] = {
+    [BIND_ACTION_NONE]            = "none",
+    [BIND_ACTION_JOYPAD_B]        = "b",
+    [BIND_ACTION_JOYPAD_Y]        = "y",
+    [BIND_ACTION_JOYPAD_SELECT]   = "select",
+    [BIND_ACTION_JOYPAD_START]    = "start",
+    [BIND_ACTION_JOYPAD_UP]       = "up",
+    [BIND_ACTION_JOYPAD_DOWN]     = "down",
+    [BIND_ACTION_JOYPAD_LEFT]     = "left",
+    [BIND_ACTION_JOYPAD_RIGHT]    = "right",
+    [BIND_ACTION_JOYPAD_A]        = "a",
+    [BIND_ACTION_JOYPAD_X]        = "x",
+    [BIND_ACTION_JOYPAD_L]        = "l",
+    [BIND_ACTION_JOYPAD_R]        = "r",
+    [BIND_ACTION_JOYPAD_L2]       = "l2",
+    [BIND_ACTION_JOYPAD_R2]       = "r2",
+    [BIND_ACTION_JOYPAD_L3]       = "l3",
+    [BIND_ACTION_JOYPAD_R3]       = "r3",
+    [BIND_ACTION_ANALOG_LX_MINUS] = "lx-",
+    [BIND_ACTION_ANALOG_LX_PLUS]  = "lx+",
+    [BIND_ACTION_ANALOG_LY_MINUS] = "ly-",
+    [BIND_ACTION_ANALOG_LY_PLUS]  = "ly+",
+    [BIND_ACTION_ANALOG_RX_MINUS] = "rx-",
+    [BIND_ACTION_ANALOG_RX_PLUS]  = "rx+",
+    [BIND_ACTION_ANALOG_RY_MINUS] = "ry-",
+    [BIND_ACTION_ANALOG_RY_PLUS]  = "ry+",
+    [BIND_ACTION_FULLSCREEN]      = "fullscreen",
+    [BIND_ACTION_MOUSE_CAPTURE]   = "mouse_capture",
+    [BIND_ACTION_STATS]           = "stats",
+    [BIND_ACTION_TRACE]           = "trace",
+    [BIND_ACTION_REWIND]          = "rewind",
+    [BIND_ACTION_FAST_FORWARD]    = "fast_forward",
+    [BIND_ACTION_SCAN_START]      = "scan_start",
+    [BIND_ACTION_SCAN_CHANGED]    = "scan_changed",
+    [BIND_ACTION_SCAN_UNCHANGED]  = "scan_unchanged",
+    [BIND_ACTION_SCAN_INCREASED]  = "scan_increased",
+    [BIND_ACTION_SCAN_DECREASED]  = "scan_decreased",
+    [BIND_ACTION_SCAN_EQUAL]      = "scan_equal",
+};
+
+// Indexed by SDL mouse button number minus one.
+static const char *g_bind_mouse_names[BIND_MOUSE_BUTTONS] = {
+    "MouseLeft", "MouseMiddle", "MouseRight", "MouseX1", "MouseX2",
+};
+
+static const bind_default_t g_bind_defaults[] = {
+    { SDL_SCANCODE_W,                           BIND_ACTION_JOYPAD_UP },
+    { SDL_SCANCODE_S,                           BIND_ACTION_JOYPAD_DOWN },
+    { SDL_SCANCODE_D,                           BIND_ACTION_JOYPAD_R },
+    { SDL_SCANCODE_A,                           BIND_ACTION_JOYPAD_L },
+    { SDL_SCANCODE_I,                           BIND_ACTION_JOYPAD_L2 },
+    { SDL_SCANCODE_K,                           BIND_ACTION_JOYPAD_R2 },
+    { SDL_SCANCODE_J,                           BIND_ACTION_JOYPAD_LEFT },
+    { SDL_SCANCODE_L,                           BIND_ACTION_JOYPAD_RIGHT },
+    { SDL_SCANCODE_X,                           BIND_ACTION_JOYPAD_A },
+    { SDL_SCANCODE_N,                           BIND_ACTION_JOYPAD_A },
+    { SDL_SCANCODE_M,                           BIND_ACTION_JOYPAD_Y },
+    { SDL_SCANCODE_SPACE,                       BIND_ACTION_JOYPAD_B },
+    { SDL_SCANCODE_BACKSPACE,                   BIND_ACTION_JOYPAD_SELECT },
+    { SDL_SCANCODE_RETURN,                      BIND_ACTION_JOYPAD_START },
+    { SDL_SCANCODE_TAB,                         BIND_ACTION_JOYPAD_X },
+    { SDL_SCANCODE_F11,                         BIND_ACTION_FULLSCREEN },
+    { SDL_SCANCODE_ESCAPE,                      BIND_ACTION_MOUSE_CAPTURE },
+    { SDL_SCANCODE_F2,                          BIND_ACTION_STATS },
+    { SDL_SCANCODE_F3,                          BIND_ACTION_TRACE },
+    { SDL_SCANCODE_R,                           BIND_ACTION_REWIND },
+    { SDL_SCANCODE_F,                           BIND_ACTION_FAST_FORWARD },
+    { SDL_SCANCODE_F5,                          BIND_ACTION_SCAN_START },
+    { SDL_SCANCODE_F6,                          BIND_ACTION_SCAN_CHANGED },
+    { SDL_SCANCODE_F7,                          BIND_ACTION_SCAN_UNCHANGED },
+    { SDL_SCANCODE_F8,                          BIND_ACTION_SCAN_INCREASED },
+    { SDL_SCANCODE_F9,                          BIND_ACTION_SCAN_DECREASED },
+    { SDL_SCANCODE_F10,                         BIND_ACTION_SCAN_EQUAL },
+    { BIND_MOUSE_BASE + SDL_BUTTON_LEFT - 1,    BIND_ACTION_JOYPAD_Y },
+    { BIND_MOUSE_BASE + SDL_BUTTON_RIGHT - 1,   BIND_ACTION_JOYPAD_X },
+};
+
+static struct {
+    Uint8 actions[SDL_SCANCODE_COUNT + BIND_MOUSE_BUTTONS];
+} g_bind;
+
+static int Bind_ParseInput(const char *name);
+
+bool Bind_Init(void)
+{
+    SDL_memset(&g_bind, 0, sizeof(g_bind));
+    for (size_t i = 0; i < SDL_arraysize(g_bind_defaults); i++)
+        g_bind.actions[g_bind_defaults[i].input] = g_bind_defaults[i].action;
+
+    for (unsigned int i = 0; i < Profile_GetBindingCount(); i++)
+    {
+        const char *key = Profile_GetBindingKey(i);
+        const char *name = Profile_GetBindingAction(i);
+
+        int input = Bind_ParseInput(key);
+        if (input < 0)
+            return SDL_SetError("unknown key \"%s\" in [bindings]", key);
+
+        bind_action_t action = BIND_ACTION_COUNT;
+        for (int a = 0; a < BIND_ACTION_COUNT; a++)
+            if (SDL_strcmp(g_bind_action_names[a], name) == 0)
+                action = a;
+        if (action == BIND_ACTION_COUNT)
+            return SDL_SetError("unknown action \"%s\" for key \"%s\" in [bindings]", name, key);
+
+        g_bind.actions[input] = action;
+    }
+
+    return true;
+}
+
+bind_action_t Bind_GetKeyAction(SDL_Scancode scancode)
+{
+    return ((unsigned)scancode < SDL_SCANCODE_COUNT) ? (g_bind.actions[scancode]) : (BIND_ACTION_NONE);
+}
+
+bind_action_t Bind_GetMouseAction(Uint8 button)
+{
+    return (button >= 1 && button <= BIND_MOUSE_BUTTONS) ? (g_bind.actions[BIND_MOUSE_BASE + button - 1]) : (BIND_ACTION_NONE);
+}
+
+int Bind_ParseInput(const char *name)
+{
+    for (int i = 0; i < BIND_MOUSE_BUTTONS; i++)
+        if (SDL_strcasecmp(g_bind_mouse_names[i], name) == 0)
+            return BIND_MOUSE_BASE + i;
+
+    SDL_Scancode scancode = SDL_GetScancodeFromName(name);
+    return (scancode != SDL_SCANCODE_UNKNOWN) ? ((int)scancode) : (-1);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_scancode.h>
+
+// Keys and mouse buttons are mapped to actions through a table indexed by scancode, built once
+// from the defaults and the [bindings] section of the profile ("<key name> = <action>").
+
+typedef enum bind_action_t bind_action_t;
+enum bind_action_t {
+    BIND_ACTION_NONE,
+    // Same order as RETRO_DEVICE_ID_JOYPAD_*.
+    BIND_ACTION_JOYPAD_B,
+    BIND_ACTION_JOYPAD_Y,
+    BIND_ACTION_JOYPAD_SELECT,
+    BIND_ACTION_JOYPAD_START,
+    BIND_ACTION_JOYPAD_UP,
+    BIND_ACTION_JOYPAD_DOWN,
+    BIND_ACTION_JOYPAD_LEFT,
+    BIND_ACTION_JOYPAD_RIGHT,
+    BIND_ACTION_JOYPAD_A,
+    BIND_ACTION_JOYPAD_X,
+    BIND_ACTION_JOYPAD_L,
+    BIND_ACTION_JOYPAD_R,
+    BIND_ACTION_JOYPAD_L2,
+    BIND_ACTION_JOYPAD_R2,
+    BIND_ACTION_JOYPAD_L3,
+    BIND_ACTION_JOYPAD_R3,
+    // Pairs of directions of RETRO_DEVICE_INDEX_ANALOG_* and RETRO_DEVICE_ID_ANALOG_* in that
+    // order, each pushes its half of the axis all the way while held.
+    BIND_ACTION_ANALOG_LX_MINUS,
+    BIND_ACTION_ANALOG_LX_PLUS,
+    BIND_ACTION_ANALOG_LY_MINUS,
+    BIND_ACTION_ANALOG_LY_PLUS,
+    BIND_ACTION_ANALOG_RX_MINUS,
+    BIND_ACTION_ANALOG_RX_PLUS,
+    BIND_ACTION_ANALOG_RY_MINUS,
+    BIND_ACTION_ANALOG_RY_PLUS,
+    BIND_ACTION_FULLSCREEN,
+    BIND_ACTION_MOUSE_CAPTURE,
+    BIND_ACTION_STATS,
+    BIND_ACTION_TRACE,
+    BIND_ACTION_REWIND,
+    BIND_ACTION_FAST_FORWARD,
+    BIND_ACTION_SCAN_START,
+    // Same order as scan_filter_t.
+    BIND_ACTION_SCAN_CHANGED,
+    BIND_ACTION_SCAN_UNCHANGED,
+    BIND_ACTION_SCAN_INCREASED,
+    BIND_ACTION_SCAN_DECREASED,
+    BIND_ACTION_SCAN_EQUAL,
+    BIND_ACTION_COUNT,
+};
+
+bool          Bind_Init(void);
+bind_action_t Bind_GetKeyAction(SDL_Scancode scancode);
+bind_action_t Bind_GetMouseAction(Uint8 button);
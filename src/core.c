@@ -7,6 +7,11 @@
 #include <SDL3/SDL_stdinc.h>
 
 #include "gl.h"
+#include "hack.h"
+#include "ring.h"
+#include "perf.h"
+#include "stats.h"
+#include "trace.h"
 #include "profile.h"
 #include "libretro.h"
 
@@ -37,6 +42,10 @@
     _X(void*,    retro_get_memory_data,            unsigned type) \
     _X(size_t,   retro_get_memory_size,            unsigned type)
 
+#define CORE_AUDIO_STAGING_FRAMES 4096
+#define CORE_AUDIO_RING_FRAMES 65536 // enough for the 512 ms a core may ask for plus headroom
+#define CORE_AUDIO_MAX_RATE_DELTA 0.005f
+
 static struct {
     bool initialized;
     SDL_AudioStream *audio;
@@ -44,6 +53,7 @@ static struct {
     struct retro_system_info info;
     struct retro_system_av_info avinfo;
     struct retro_hw_render_callback *hw;
+    pixel_format_t pixel_format;
     struct {
         #define _X(_ret, _name, _arg1, ...) _ret (*_name)(_arg1, ##__VA_ARGS__);
         RETRO_API_DECL_LIST
@@ -54,20 +64,80 @@ static struct {
         char system[256];
     } paths;
     float current_width, current_height;
-    int16_t inputs[16];
-    core_mouse_hack_t mouse_hack_profile;
+    bool new_frame;
+    Uint64 shown_frames;
+    Uint64 duplicate_frames;
+    Uint16 joypad; // one bit per RETRO_DEVICE_ID_JOYPAD_*
+    Uint8 analog;  // one bit per held direction, minus and plus of each axis of both sticks
+    core_input_poll_t input_poll;
+    bool input_pending;
+    int av_enable;
+    bool audio_muted;
+    bool fast_forward;
+    enum retro_savestate_context savestate_context;
+    struct {
+        unsigned int frames;
+        void *state;
+        size_t state_size;
+        Uint64 count;
+        Uint64 serialize_ns;
+        Uint64 hidden_ns;
+        Uint64 unserialize_ns;
+        Uint64 max_ns;
+    } runahead;
+    // Samples from both audio callbacks are collected here and handed to SDL once per frame,
+    // either straight into the stream or through a ring that the audio device thread drains
+    // so that the emulation thread never takes the stream lock.
+    struct {
+        int16_t samples[CORE_AUDIO_STAGING_FRAMES * 2];
+        size_t count;
+        bool use_ring;
+        ring_t ring;
+        int16_t ring_data[CORE_AUDIO_RING_FRAMES * 2];
+        Uint64 frames;
+        Uint64 pushes;
+        Uint64 runs;
+        Uint64 dropped;
+    } staging;
+    // Queue depth is in stereo samples waiting to be played, the resampling ratio is nudged
+    // every frame to keep it around the target so the audio clock and the frame clock can't
+    // drift apart. With the ring the ratio is handed to the device callback as float bits and
+    // set on the stream from there.
+    struct {
+        bool rate_control;
+        size_t target;
+        unsigned int min_latency;
+        retro_audio_buffer_status_callback_t status_cb;
+        float ratio;
+        SDL_AtomicInt ratio_bits;
+        float stream_ratio;
+        Uint64 underruns;
+        Uint64 overruns;
+    } sync;
 } g_core;
 
 static retro_proc_address_t Core_GlGetProcAddress(const char *sym);
 
 static void    Core_LogCb(enum retro_log_level level, const char *format, ...);
 static bool    Core_EnvCb(unsigned cmd, void *data);
+static bool    Core_HandleEnv(unsigned cmd, void *data);
 static void    Core_VideoCb(const void *data, unsigned width, unsigned height, size_t pitch);
 static void    Core_AudioSampleCb(int16_t left, int16_t right);
 static size_t  Core_AudioBatchCb(const int16_t *data, size_t frames);
 static void    Core_InputPollCb(void);
 static int16_t Core_InputStateCb(unsigned port, unsigned device, unsigned index, unsigned id);
 
+static void    Core_RunAhead(void);
+static void    Core_RunOnce(void);
+static int     Core_GetAvEnable(void);
+static void    Core_StageAudio(const int16_t *data, size_t frames);
+static void    Core_FlushAudio(void);
+static void    Core_SyncAudio(void);
+static void    Core_ReportAudioStatus(void);
+static void    Core_UpdateAudioTarget(void);
+static size_t  Core_GetQueuedAudio(void);
+static void    Core_AudioStreamCb(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount);
+
 bool Core_Load(const char *path)
 {
     Core_Free();
@@ -79,6 +149,25 @@ bool Core_Load(const char *path)
     #undef _X
 
     g_core.initialized = true;
+    g_core.av_enable = RETRO_AV_ENABLE_VIDEO | RETRO_AV_ENABLE_AUDIO;
+    g_core.savestate_context = RETRO_SAVESTATE_CONTEXT_NORMAL;
+    g_core.pixel_format = PIXEL_FORMAT_0RGB1555;
+    g_core.runahead.frames = Profile_GetRunAheadFrames();
+    g_core.staging.use_ring = Profile_IsAudioRingEnabled();
+    Ring_Init(&g_core.staging.ring, g_core.staging.ring_data, sizeof(int16_t) * 2, CORE_AUDIO_RING_FRAMES);
+    g_core.sync.rate_control = Profile_IsAudioRateControlEnabled();
+    g_core.sync.ratio = 1;
+    g_core.sync.stream_ratio = 1;
+    int one_bits;
+    SDL_memcpy(&one_bits, &g_core.sync.ratio, sizeof(one_bits));
+    SDL_SetAtomicInt(&g_core.sync.ratio_bits, one_bits);
+    // Audio pacing already holds the queue at the target, resampling on top of it would correct
+    // the same drift twice and run emulation slightly fast.
+    if (g_core.sync.rate_control && Profile_IsAudioPacingEnabled())
+    {
+        SDL_Log("audio pacing is enabled, keeping the resampling ratio at 1");
+        g_core.sync.rate_control = false;
+    }
 
     g_core.api.retro_get_system_info(&g_core.info);
 
@@ -99,12 +188,14 @@ bool Core_Load(const char *path)
             .channels = 2,
             .freq = g_core.avinfo.timing.sample_rate,
         },
-        0,
+        (g_core.staging.use_ring) ? (Core_AudioStreamCb) : (0),
         0
     );
     if (!g_core.audio) return false;
     SDL_ResumeAudioStreamDevice(g_core.audio);
 
+    Core_UpdateAudioTarget();
+
     SDL_Log(
         "loaded core %s (%.0f FPS, %dx%d, %.0f Hz)",
         g_core.info.library_name,
@@ -120,52 +211,53 @@ bool Core_LoadGame(const char *path)
 {
     if (!g_core.initialized) return SDL_SetError("core was not initialized");
     struct retro_game_info info = { .path = path };
-    return g_core.api.retro_load_game(&info);
-}
+    if (!g_core.api.retro_load_game(&info)) return SDL_SetError("failed to load game \"%s\"", path);
 
-bool Core_LoadState(const char *path)
-{
-    void *s = 0;
-    size_t ss = 0;
-    if (!(s = SDL_LoadFile(path, &ss)))
+    // Cores that did not set up hardware rendering while loading hand frames over in system
+    // memory, the geometry is only reliable now that the game is loaded.
+    if (!g_core.hw)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to read save file");
-        return false;
+        struct retro_system_av_info av;
+        g_core.api.retro_get_system_av_info(&av);
+        if (!Gl_Configure(3, 3, av.geometry.max_width, av.geometry.max_height) || !Gl_StartSoftwareFrames()) return false;
     }
-    
-    if (!g_core.api.retro_unserialize(s, ss))
+
+    // The run-ahead snapshot is allocated up front so a failure shows up here and not mid-game.
+    if (g_core.runahead.frames)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "retro_unserialize() failed");
-        SDL_free(s);
-        return false;
+        g_core.runahead.state_size = g_core.api.retro_serialize_size();
+        if (!g_core.runahead.state_size || !(g_core.runahead.state = SDL_malloc(g_core.runahead.state_size)))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to allocate %zu bytes for run-ahead state, disabling run-ahead", g_core.runahead.state_size);
+            g_core.runahead.state_size = 0;
+            g_core.runahead.frames = 0;
+        }
     }
-
-    SDL_Log("Loaded save");
-    SDL_free(s);
     return true;
 }
 
-bool Core_SaveState(const char *path)
+size_t Core_GetStateSize(void)
 {
-    size_t size = g_core.api.retro_serialize_size();
-    void *data = SDL_malloc(size);
+    SDL_assert_release(g_core.initialized);
+    return g_core.api.retro_serialize_size();
+}
 
-    if (!g_core.api.retro_serialize(data, size))
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "retro_serialize() failed");
-        SDL_free(data);
-        return false;
-    }
-    else if (!SDL_SaveFile(path, data, size))
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to write save state");
-        SDL_free(data);
-        return false;
-    }
+bool Core_SerializeState(void *data, size_t size)
+{
+    SDL_assert_release(g_core.initialized);
+    Trace_Begin("retro_serialize");
+    bool ok = data && g_core.api.retro_serialize(data, size);
+    Trace_End("retro_serialize");
+    return ok;
+}
 
-    SDL_Log("Saved state to \"%s\"", path);
-    SDL_free(data);
-    return true;
+bool Core_UnserializeState(const void *data, size_t size)
+{
+    SDL_assert_release(g_core.initialized);
+    Trace_Begin("retro_unserialize");
+    bool ok = g_core.api.retro_unserialize(data, size);
+    Trace_End("retro_unserialize");
+    return ok;
 }
 
 void Core_Free(void)
@@ -173,10 +265,47 @@ void Core_Free(void)
     if (!g_core.initialized)
         return;
 
+    if (g_core.runahead.count)
+    {
+        double n = g_core.runahead.count * 1e6;
+        SDL_Log(
+            "run-ahead of %u frames cost %.2f ms per frame (serialize %.2f, hidden frames %.2f, unserialize %.2f, max %.2f)",
+            g_core.runahead.frames,
+            (g_core.runahead.serialize_ns + g_core.runahead.hidden_ns + g_core.runahead.unserialize_ns) / n,
+            g_core.runahead.serialize_ns / n,
+            g_core.runahead.hidden_ns / n,
+            g_core.runahead.unserialize_ns / n,
+            g_core.runahead.max_ns / 1e6
+        );
+    }
+
+    if (g_core.staging.runs)
+    {
+        SDL_Log(
+            "audio: %.1f stereo samples and %.2f pushes to SDL per frame, %llu dropped",
+            g_core.staging.frames / (double)g_core.staging.runs,
+            g_core.staging.pushes / (double)g_core.staging.runs,
+            (unsigned long long)g_core.staging.dropped
+        );
+        SDL_Log(
+            "audio: %llu underruns, %llu overruns, resampling ratio %.4f",
+            (unsigned long long)g_core.sync.underruns,
+            (unsigned long long)g_core.sync.overruns,
+            g_core.sync.ratio
+        );
+    }
+
+    if (g_core.shown_frames)
+        SDL_Log("%llu of %llu frames were duplicates", (unsigned long long)g_core.duplicate_frames, (unsigned long long)g_core.shown_frames);
+
+    Perf_Log();
+    Hack_Free();
     g_core.api.retro_unload_game();
     g_core.api.retro_deinit();
+    Perf_Reset();
     SDL_UnloadObject(g_core.so);
     SDL_DestroyAudioStream(g_core.audio);
+    SDL_free(g_core.runahead.state);
     SDL_memset(&g_core, 0, sizeof(g_core));
     SDL_ClearError();
 }
@@ -184,8 +313,117 @@ void Core_Free(void)
 void Core_RunFrame(void)
 {
     SDL_assert_release(g_core.initialized);
+
+    Trace_Begin("Core_RunFrame");
+
+    g_core.new_frame = false;
+    g_core.input_pending = true;
+
+    Uint64 t0 = SDL_GetTicksNS();
+    if (g_core.runahead.frames)
+        Core_RunAhead();
+    else
+        Core_RunOnce();
+
+    // Input that a core didn't poll for is still taken so nothing piles up in the meantime.
+    Core_InputPollCb();
+
+    Uint64 t1 = SDL_GetTicksNS();
+    Core_SyncAudio();
+
+    Stats_Record(STATS_STAGE_RUN, t1 - t0);
+    Stats_Record(STATS_STAGE_AUDIO, SDL_GetTicksNS() - t1);
+
+    g_core.shown_frames++;
+    if (!g_core.new_frame) g_core.duplicate_frames++;
+
+    Trace_End("Core_RunFrame");
+}
+
+void Core_RunAhead(void)
+{
+    // The real frame is run with audio only and its state is kept, the following frames are
+    // run with everything suppressed except the video of the last one which is what gets
+    // presented. Rolling back to the kept state hides them from the emulated game.
+    g_core.av_enable = RETRO_AV_ENABLE_AUDIO | RETRO_AV_ENABLE_FAST_SAVESTATES;
+    Core_RunOnce();
+
+    Uint64 t0 = SDL_GetTicksNS();
+
+    // Cores can report a larger size once the game is running, the buffer is not grown mid-game.
+    size_t size = g_core.api.retro_serialize_size();
+
+    g_core.savestate_context = RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE;
+    bool grown = size > g_core.runahead.state_size;
+    if (grown || !g_core.api.retro_serialize(g_core.runahead.state, size))
+    {
+        if (grown)
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "state size grew from %zu to %zu bytes, disabling run-ahead", g_core.runahead.state_size, size);
+        else
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "retro_serialize() failed, disabling run-ahead");
+        g_core.runahead.frames = 0;
+        g_core.savestate_context = RETRO_SAVESTATE_CONTEXT_NORMAL;
+        g_core.av_enable = RETRO_AV_ENABLE_VIDEO | RETRO_AV_ENABLE_AUDIO;
+        return;
+    }
+
+    Uint64 t1 = SDL_GetTicksNS();
+
+    for (unsigned int i = 1; i <= g_core.runahead.frames; i++)
+    {
+        g_core.av_enable = RETRO_AV_ENABLE_FAST_SAVESTATES | ((i == g_core.runahead.frames) ? (RETRO_AV_ENABLE_VIDEO) : (0));
+        Core_RunOnce();
+    }
+
+    Uint64 t2 = SDL_GetTicksNS();
+
+    if (!g_core.api.retro_unserialize(g_core.runahead.state, size))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "retro_unserialize() failed, disabling run-ahead");
+        g_core.runahead.frames = 0;
+    }
+
+    Uint64 t3 = SDL_GetTicksNS();
+
+    g_core.savestate_context = RETRO_SAVESTATE_CONTEXT_NORMAL;
+    g_core.av_enable = RETRO_AV_ENABLE_VIDEO | RETRO_AV_ENABLE_AUDIO;
+
+    g_core.runahead.count++;
+    g_core.runahead.serialize_ns += t1 - t0;
+    g_core.runahead.hidden_ns += t2 - t1;
+    g_core.runahead.unserialize_ns += t3 - t2;
+    g_core.runahead.max_ns = SDL_max(g_core.runahead.max_ns, t3 - t0);
+}
+
+void Core_SkipFrame(void)
+{
+    SDL_assert_release(g_core.initialized);
+
+    // Neither shown nor heard, the core can skip rendering and audio synthesis entirely.
+    Trace_Begin("Core_SkipFrame");
+    g_core.av_enable = 0;
+    Core_RunOnce();
+    g_core.av_enable = RETRO_AV_ENABLE_VIDEO | RETRO_AV_ENABLE_AUDIO;
+    Trace_End("Core_SkipFrame");
+}
+
+void Core_RunOnce(void)
+{
+    // Every retro_run() sees the current queue depth, run-ahead and skipped frames included.
+    Core_ReportAudioStatus();
     g_core.api.retro_run();
-    SDL_FlushAudioStream(g_core.audio);
+}
+
+int Core_GetAvEnable(void)
+{
+    // Audio is dropped entirely while fast-forwarding instead of being played back sped up.
+    return g_core.av_enable & ~((g_core.fast_forward) ? (RETRO_AV_ENABLE_AUDIO) : (0));
+}
+
+bool Core_HasNewFrame(void)
+{
+    SDL_assert_release(g_core.initialized);
+    return g_core.new_frame;
 }
 
 float Core_GetRenderWidth(void)
@@ -200,66 +438,103 @@ float Core_GetRenderHeight(void)
     return g_core.current_height;
 }
 
+float Core_GetAudioLatency(void)
+{
+    SDL_assert_release(g_core.initialized);
+    return Core_GetQueuedAudio() * 1000.0f / g_core.avinfo.timing.sample_rate;
+}
+
+float Core_GetAudioTargetLatency(void)
+{
+    SDL_assert_release(g_core.initialized);
+    return g_core.sync.target * 1000.0f / g_core.avinfo.timing.sample_rate;
+}
+
+bool Core_IsAudioPlaying(void)
+{
+    SDL_assert_release(g_core.initialized);
+    return !g_core.audio_muted && (Core_GetAvEnable() & RETRO_AV_ENABLE_AUDIO) && !SDL_AudioStreamDevicePaused(g_core.audio);
+}
+
+Uint64 Core_GetAudioUnderrunCount(void)
+{
+    SDL_assert_release(g_core.initialized);
+    return g_core.sync.underruns;
+}
+
+Uint64 Core_GetAudioOverrunCount(void)
+{
+    SDL_assert_release(g_core.initialized);
+    return g_core.sync.overruns;
+}
+
 float Core_GetTargetFPS(void)
 {
     SDL_assert_release(g_core.initialized);
     return g_core.avinfo.timing.fps;
 }
 
-void Core_SetJoypadAxis(uint8_t axis, int16_t value)
+bool Core_IsFastForwarding(void)
 {
-    SDL_assert_release(axis < SDL_arraysize(g_core.inputs));
-    g_core.inputs[axis] = value;
+    SDL_assert_release(g_core.initialized);
+    return g_core.fast_forward;
 }
 
-void Core_SetMouseHackProfile(core_mouse_hack_t profile)
+void Core_SetFastForward(bool enabled)
 {
-    g_core.mouse_hack_profile = profile;
-    SDL_Log("Using mouse hack %d", profile);
+    SDL_assert_release(g_core.initialized);
+    g_core.fast_forward = enabled;
 }
 
-void Core_SetMouseMove(float rx, float ry)
+void Core_SetAudioMuted(bool muted)
 {
     SDL_assert_release(g_core.initialized);
+    g_core.audio_muted = muted;
+}
 
-    size_t core_memory_size;
-    uint8_t *core_memory;
-    SDL_assert_release(core_memory_size = g_core.api.retro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM));
-    SDL_assert_release(core_memory = g_core.api.retro_get_memory_data(RETRO_MEMORY_SYSTEM_RAM));
+void Core_SetJoypadAxis(uint8_t axis, int16_t value)
+{
+    SDL_assert_release(axis < 16);
+    g_core.joypad = (value) ? (g_core.joypad | (1u << axis)) : (g_core.joypad & ~(1u << axis));
+}
 
-    if (g_core.mouse_hack_profile == CORE_MOUSE_HACK_AC)
-    {
-        // https://github.com/garungorp/MouseInjectorDolphinDuck/blob/master/games/ps1_acore.c
-        if      (!(*(uint16_t*)(core_memory + 0x1AC80C))) return;
-        else if (!(*(uint16_t*)(core_memory + 0x39AD4))) return;
-        else if (core_memory[0x14C82B]) return;
-        else if (core_memory[0x1FE06E] == 0x1A) return;
-        *(uint16_t*)(core_memory + 0x1A26CA) -= rx;
-        *(uint16_t*)(core_memory + 0x411C0) += ry;
-    }
-    else if (g_core.mouse_hack_profile == CORE_MOUSE_HACK_AC_PROJECT_PHANTASMA)
-    {
-        // https://github.com/garungorp/MouseInjectorDolphinDuck/blob/master/games/ps1_acorepp.c
-        bool is_arena = *(uint32_t*)(core_memory + 0x1D1D20) == 0x801D1CC8;
-        if      (!core_memory[0x1A7FAC] && !is_arena) return;
-        else if (!core_memory[0x3BA14]) return;
-        else if (core_memory[0x1555EB] && !is_arena) return;
-
-        uint32_t camera_x_offset = (is_arena) ? (0x1D1D32) : (0x1E2DF2);
-        *(uint16_t*)(core_memory + camera_x_offset) -= rx;
-        *(uint16_t*)(core_memory + 0x42708) += ry;
-    }
-    else if (g_core.mouse_hack_profile == CORE_MOUSE_HACK_AC_MASTER_OF_ARENA)
+void Core_SetAnalogDirection(uint8_t direction, int16_t value)
+{
+    SDL_assert_release(direction < 8);
+    g_core.analog = (value) ? (g_core.analog | (1u << direction)) : (g_core.analog & ~(1u << direction));
+}
+
+void Core_SetInputPollCallback(core_input_poll_t poll)
+{
+    g_core.input_poll = poll;
+}
+
+Uint8 *Core_GetSystemRam(size_t *size)
+{
+    SDL_assert_release(g_core.initialized);
+
+    // System RAM stays at the same address for as long as the game is loaded.
+    Uint8 *ram = g_core.api.retro_get_memory_data(RETRO_MEMORY_SYSTEM_RAM);
+    *size = g_core.api.retro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM);
+    if (!ram || !*size)
     {
-        // https://github.com/GoldenLumia/MouseInjectorDolphinDuck/blob/master/games%2Fps1_acoremoa.c
-        bool is_arena = *(uint32_t*)(core_memory + 0x1D8C70) == 0x801A6E80;
-        if      (!core_memory[0x1BA72C] && !is_arena) return;
-        else if (!core_memory[0x3E720]) return;
-
-        uint32_t camera_x_offset = (is_arena) ? (0x1D8C1A) : (0x1E725A);
-        *(uint16_t*)(core_memory + camera_x_offset) -= rx;
-        *(uint16_t*)(core_memory + 0x453B0) += ry;
+        SDL_SetError("core does not expose system RAM");
+        return 0;
     }
+    return ram;
+}
+
+bool Core_SetMouseHack(const char *program)
+{
+    size_t size;
+    Uint8 *ram = Core_GetSystemRam(&size);
+    return ram && Hack_Compile(program, ram, size);
+}
+
+void Core_SetMouseMove(float rx, float ry)
+{
+    SDL_assert_release(g_core.initialized);
+    Hack_Apply(rx, ry);
 }
 
 retro_proc_address_t Core_GlGetProcAddress(const char *sym)
@@ -284,6 +559,14 @@ void Core_LogCb(enum retro_log_level level, const char *format, ...)
 }
 
 bool Core_EnvCb(unsigned cmd, void *data)
+{
+    Trace_BeginArg("Core_EnvCb", cmd);
+    bool handled = Core_HandleEnv(cmd, data);
+    Trace_End("Core_EnvCb");
+    return handled;
+}
+
+bool Core_HandleEnv(unsigned cmd, void *data)
 {
     SDL_assert_release(g_core.initialized);
 
@@ -302,22 +585,46 @@ bool Core_EnvCb(unsigned cmd, void *data)
         return true;
 
     case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
-        return *(enum retro_pixel_format*)data == RETRO_PIXEL_FORMAT_XRGB8888;
+        switch (*(enum retro_pixel_format*)data)
+        {
+        case RETRO_PIXEL_FORMAT_0RGB1555: g_core.pixel_format = PIXEL_FORMAT_0RGB1555; return true;
+        case RETRO_PIXEL_FORMAT_XRGB8888: g_core.pixel_format = PIXEL_FORMAT_XRGB8888; return true;
+        case RETRO_PIXEL_FORMAT_RGB565:   g_core.pixel_format = PIXEL_FORMAT_RGB565;   return true;
+        default: return false;
+        }
+
+    case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+        *(bool*)data = true;
+        return true;
+
+    case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS:
+        return true;
+
+    case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+        // Only handed out when no conversion is needed and the core won't read it back, the
+        // mapped buffer is write-combined memory.
+        struct retro_framebuffer *fb = data;
+        if (g_core.hw || g_core.pixel_format != PIXEL_FORMAT_XRGB8888 || (fb->access_flags & RETRO_MEMORY_ACCESS_READ)) return false;
+        if (!(fb->data = Gl_MapFrame(fb->width, fb->height, &fb->pitch))) return false;
+        fb->format = RETRO_PIXEL_FORMAT_XRGB8888;
+        fb->memory_flags = 0;
+        return true;
 
     case RETRO_ENVIRONMENT_GET_PREFERRED_HW_RENDER:
         *(unsigned*)data = RETRO_HW_CONTEXT_OPENGL_CORE;
         return true;
 
     case RETRO_ENVIRONMENT_SET_HW_RENDER:
-        g_core.hw = data;
-
+        // The core falls back to software rendering if this fails.
         if (!Gl_Configure(
-            g_core.hw->version_major,
-            g_core.hw->version_minor,
+            ((struct retro_hw_render_callback*)data)->version_major,
+            ((struct retro_hw_render_callback*)data)->version_minor,
             g_core.avinfo.geometry.max_width,
             g_core.avinfo.geometry.max_height
         )) return false;
 
+        g_core.hw = data;
+
         g_core.hw->get_proc_address = Core_GlGetProcAddress;
         g_core.hw->get_current_framebuffer = Gl_GetFramebuffer;
         g_core.hw->context_reset();
@@ -329,6 +636,32 @@ bool Core_EnvCb(unsigned cmd, void *data)
 
     case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
         return false;
+
+    case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE:
+        *(int*)data = Core_GetAvEnable();
+        return true;
+
+    case RETRO_ENVIRONMENT_GET_FASTFORWARDING:
+        *(bool*)data = g_core.fast_forward;
+        return true;
+
+    case RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT:
+        *(int*)data = g_core.savestate_context;
+        return true;
+
+    case RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK:
+        g_core.sync.status_cb = (data) ? (((struct retro_audio_buffer_status_callback*)data)->callback) : (0);
+        return true;
+
+    case RETRO_ENVIRONMENT_SET_MINIMUM_AUDIO_LATENCY:
+        g_core.sync.min_latency = (data) ? (*(const unsigned*)data) : (0);
+        Core_UpdateAudioTarget();
+        SDL_Log("core requested at least %u ms of audio latency", g_core.sync.min_latency);
+        return true;
+
+    case RETRO_ENVIRONMENT_GET_PERF_INTERFACE:
+        Perf_GetInterface(data);
+        return true;
     }
 
     SDL_Log("unhandled core command %u", cmd);
@@ -338,6 +671,17 @@ bool Core_EnvCb(unsigned cmd, void *data)
 void Core_VideoCb(const void *data, unsigned width, unsigned height, size_t pitch)
 {
     SDL_assert_release(g_core.initialized);
+    if (!(Core_GetAvEnable() & RETRO_AV_ENABLE_VIDEO)) return;
+
+    // A null frame repeats the previous one, the framebuffer was not touched.
+    if (!data) return;
+    if (!g_core.hw)
+    {
+        Trace_Begin("Gl_UploadFrame");
+        Gl_UploadFrame(g_core.pixel_format, data, width, height, pitch);
+        Trace_End("Gl_UploadFrame");
+    }
+    g_core.new_frame = true;
     g_core.current_width = width;
     g_core.current_height = height;
 }
@@ -345,25 +689,166 @@ void Core_VideoCb(const void *data, unsigned width, unsigned height, size_t pitc
 void Core_AudioSampleCb(int16_t left, int16_t right)
 {
     SDL_assert_release(g_core.initialized);
-    int16_t buf[] = { left, right };
-    SDL_PutAudioStreamData(g_core.audio, buf, sizeof(buf));
+    if (!(Core_GetAvEnable() & RETRO_AV_ENABLE_AUDIO) || g_core.audio_muted) return;
+    Core_StageAudio((int16_t[]){ left, right }, 1);
 }
 
 size_t Core_AudioBatchCb(const int16_t *data, size_t frames)
 {
     SDL_assert_release(g_core.initialized);
-    SDL_PutAudioStreamData(g_core.audio, data, frames * sizeof(int16_t) * 2);
+    if (!(Core_GetAvEnable() & RETRO_AV_ENABLE_AUDIO) || g_core.audio_muted) return frames;
+    Trace_Begin("Core_AudioBatchCb");
+    Core_StageAudio(data, frames);
+    Trace_End("Core_AudioBatchCb");
     return frames;
 }
 
 void Core_InputPollCb(void)
 {
+    // Only the first poll of a shown frame samples input, with run-ahead the frames that are
+    // rolled back afterwards would otherwise swallow mouse motion.
+    if (!g_core.input_pending || !g_core.input_poll)
+        return;
+
+    g_core.input_pending = false;
+    Trace_Begin("Core_InputPollCb");
+    g_core.input_poll();
+    Trace_End("Core_InputPollCb");
 }
 
 int16_t Core_InputStateCb(unsigned port, unsigned device, unsigned index, unsigned id)
 {
     SDL_assert_release(g_core.initialized);
-    if (port != 0 || device != RETRO_DEVICE_JOYPAD || index != 0 || id >= SDL_arraysize(g_core.inputs))
+    if (port != 0)
         return 0;
-    return g_core.inputs[id];
+
+    if (device == RETRO_DEVICE_ANALOG && index <= RETRO_DEVICE_INDEX_ANALOG_RIGHT && id <= RETRO_DEVICE_ID_ANALOG_Y)
+    {
+        // Opposite directions held together cancel out.
+        unsigned int axis = index * 2 + id;
+        int minus = (g_core.analog >> (axis * 2)) & 1;
+        int plus = (g_core.analog >> (axis * 2 + 1)) & 1;
+        return (int16_t)((plus - minus) * 0x7FFF);
+    }
+
+    if (device != RETRO_DEVICE_JOYPAD || index != 0)
+        return 0;
+    if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+        return (int16_t)g_core.joypad;
+    return (id < 16) ? ((g_core.joypad >> id) & 1) : (0);
+}
+
+void Core_StageAudio(const int16_t *data, size_t frames)
+{
+    g_core.staging.frames += frames;
+    while (frames)
+    {
+        size_t n = SDL_min(frames, CORE_AUDIO_STAGING_FRAMES - g_core.staging.count);
+        SDL_memcpy(g_core.staging.samples + g_core.staging.count * 2, data, n * sizeof(int16_t) * 2);
+        g_core.staging.count += n;
+        data += n * 2;
+        frames -= n;
+
+        if (g_core.staging.count == CORE_AUDIO_STAGING_FRAMES)
+            Core_FlushAudio();
+    }
+}
+
+void Core_FlushAudio(void)
+{
+    if (!g_core.staging.count)
+        return;
+
+    if (g_core.staging.use_ring)
+        g_core.staging.dropped += g_core.staging.count - Ring_Write(&g_core.staging.ring, g_core.staging.samples, g_core.staging.count);
+    else
+        SDL_PutAudioStreamData(g_core.audio, g_core.staging.samples, g_core.staging.count * sizeof(int16_t) * 2);
+
+    g_core.staging.pushes++;
+    g_core.staging.count = 0;
+}
+
+void Core_SyncAudio(void)
+{
+    // Sampled before this frame's samples are added, an empty queue means the device ran dry
+    // since the last frame.
+    size_t queued = Core_GetQueuedAudio();
+    bool playing = !g_core.audio_muted && !g_core.fast_forward && g_core.staging.runs;
+    if (playing && !queued) g_core.sync.underruns++;
+
+    queued += g_core.staging.count;
+    Core_FlushAudio();
+    if (!g_core.staging.use_ring) SDL_FlushAudioStream(g_core.audio);
+    g_core.staging.runs++;
+
+    if (playing && queued > g_core.sync.target * 2) g_core.sync.overruns++;
+
+    if (g_core.sync.rate_control && playing && g_core.sync.target)
+    {
+        // A queue below the target is consumed slower so it fills up and vice versa.
+        float d = SDL_clamp(((float)g_core.sync.target - (float)queued) / g_core.sync.target, -1.0f, 1.0f);
+        g_core.sync.ratio = 1.0f - CORE_AUDIO_MAX_RATE_DELTA * d;
+        if (g_core.staging.use_ring)
+        {
+            int bits;
+            SDL_memcpy(&bits, &g_core.sync.ratio, sizeof(bits));
+            SDL_SetAtomicInt(&g_core.sync.ratio_bits, bits);
+        }
+        else
+        {
+            SDL_SetAudioStreamFrequencyRatio(g_core.audio, g_core.sync.ratio);
+        }
+    }
+}
+
+void Core_ReportAudioStatus(void)
+{
+    // The buffer is considered to be twice the target depth which is where overruns start,
+    // below a quarter of it the core is told to skip frames.
+    if (!g_core.sync.status_cb)
+        return;
+
+    bool active = !g_core.audio_muted && !g_core.fast_forward && g_core.sync.target;
+    size_t queued = Core_GetQueuedAudio();
+    unsigned occupancy = (active) ? (SDL_min(queued * 100 / (g_core.sync.target * 2), 100)) : (0);
+    g_core.sync.status_cb(active, occupancy, active && occupancy < 25);
+}
+
+void Core_UpdateAudioTarget(void)
+{
+    // The ring can't hold more than its capacity so the target has to leave room above it.
+    double ms = SDL_max(Profile_GetAudioLatency(), g_core.sync.min_latency);
+    g_core.sync.target = SDL_min(ms * g_core.avinfo.timing.sample_rate / 1000.0, CORE_AUDIO_RING_FRAMES / 2);
+}
+
+size_t Core_GetQueuedAudio(void)
+{
+    // With the ring the device callback only pulls what it is about to play so the stream
+    // itself stays close to empty.
+    if (g_core.staging.use_ring)
+        return Ring_GetCount(&g_core.staging.ring);
+    return SDL_max(SDL_GetAudioStreamQueued(g_core.audio), 0) / (sizeof(int16_t) * 2);
+}
+
+void Core_AudioStreamCb(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount)
+{
+    // Runs on the audio device thread with the stream already locked.
+    float ratio;
+    int bits = SDL_GetAtomicInt(&g_core.sync.ratio_bits);
+    SDL_memcpy(&ratio, &bits, sizeof(ratio));
+    if (ratio != g_core.sync.stream_ratio)
+    {
+        SDL_SetAudioStreamFrequencyRatio(stream, ratio);
+        g_core.sync.stream_ratio = ratio;
+    }
+
+    int16_t chunk[512 * 2];
+    Uint32 frames = additional_amount / (sizeof(int16_t) * 2);
+    while (frames)
+    {
+        Uint32 n = Ring_Read(&g_core.staging.ring, chunk, SDL_min(frames, SDL_arraysize(chunk) / 2));
+        if (!n) break;
+        SDL_PutAudioStreamData(stream, chunk, n * sizeof(int16_t) * 2);
+        frames -= n;
+    }
 }
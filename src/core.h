@@ -2,25 +2,36 @@
 
 #include <SDL3/SDL_stdinc.h>
 
-typedef enum core_mouse_hack_t core_mouse_hack_t;
-enum core_mouse_hack_t {
-    CORE_MOUSE_HACK_AC,
-    CORE_MOUSE_HACK_AC_PROJECT_PHANTASMA,
-    CORE_MOUSE_HACK_AC_MASTER_OF_ARENA,
-};
+typedef void (*core_input_poll_t)(void);
 
 bool Core_Load(const char *path);
 bool Core_LoadGame(const char *path);
-bool Core_LoadState(const char *path);
-bool Core_SaveState(const char *path);
 void Core_Free(void);
 
+Uint8 *Core_GetSystemRam(size_t *size);
+size_t Core_GetStateSize(void);
+bool   Core_SerializeState(void *data, size_t size);
+bool   Core_UnserializeState(const void *data, size_t size);
+
 void Core_RunFrame(void);
+void Core_SkipFrame(void);
 
+bool  Core_HasNewFrame(void);
 float Core_GetRenderWidth(void);
 float Core_GetRenderHeight(void);
 float Core_GetTargetFPS(void);
+float Core_GetAudioLatency(void);
+float Core_GetAudioTargetLatency(void);
+
+bool   Core_IsAudioPlaying(void);
+Uint64 Core_GetAudioUnderrunCount(void);
+Uint64 Core_GetAudioOverrunCount(void);
+bool   Core_IsFastForwarding(void);
 
+void Core_SetFastForward(bool enabled);
+void Core_SetAudioMuted(bool muted);
 void Core_SetJoypadAxis(uint8_t axis, int16_t value);
-void Core_SetMouseHackProfile(core_mouse_hack_t profile);
+void Core_SetAnalogDirection(uint8_t direction, int16_t value);
+void Core_SetInputPollCallback(core_input_poll_t poll);
+bool Core_SetMouseHack(const char *program);
 void Core_SetMouseMove(float rx, float ry);
@@ -2,18 +2,26 @@
 
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_error.h>
+#include <SDL3/SDL_atomic.h>
 #include <SDL3/SDL_loadso.h>
 #include <SDL3/SDL_opengl.h>
 #include <SDL3/SDL_opengl_glext.h>
 
+#include "stats.h"
+#include "trace.h"
+#include "profile.h"
 #include "renderdoc.h"
 
 #define OPENGL_EXT_API_LIST \
     _X(PFNGLGENVERTEXARRAYSPROC,         glGenVertexArrays) \
     _X(PFNGLBINDVERTEXARRAYPROC,         glBindVertexArray) \
+    _X(PFNGLDELETEVERTEXARRAYSPROC,      glDeleteVertexArrays) \
     _X(PFNGLGENBUFFERSPROC,              glGenBuffers) \
     _X(PFNGLBINDBUFFERPROC,              glBindBuffer) \
     _X(PFNGLBUFFERDATAPROC,              glBufferData) \
+    _X(PFNGLBUFFERSUBDATAPROC,           glBufferSubData) \
+    _X(PFNGLMAPBUFFERRANGEPROC,          glMapBufferRange) \
+    _X(PFNGLUNMAPBUFFERPROC,             glUnmapBuffer) \
     _X(PFNGLVERTEXATTRIBPOINTERPROC,     glVertexAttribPointer) \
     _X(PFNGLENABLEVERTEXATTRIBARRAYPROC, glEnableVertexAttribArray) \
     _X(PFNGLCREATESHADERPROC,            glCreateShader) \
@@ -25,9 +33,30 @@
     _X(PFNGLLINKPROGRAMPROC,             glLinkProgram) \
     _X(PFNGLUSEPROGRAMPROC,              glUseProgram) \
     _X(PFNGLGENFRAMEBUFFERSPROC,         glGenFramebuffers) \
+    _X(PFNGLDELETEFRAMEBUFFERSPROC,      glDeleteFramebuffers) \
     _X(PFNGLBINDFRAMEBUFFERPROC,         glBindFramebuffer) \
     _X(PFNGLFRAMEBUFFERTEXTURE2DPROC,    glFramebufferTexture2D) \
-    _X(PFNGLCHECKFRAMEBUFFERSTATUSPROC,  glCheckFramebufferStatus)
+    _X(PFNGLCHECKFRAMEBUFFERSTATUSPROC,  glCheckFramebufferStatus) \
+    _X(PFNGLBLITFRAMEBUFFERPROC,         glBlitFramebuffer) \
+    _X(PFNGLFENCESYNCPROC,               glFenceSync) \
+    _X(PFNGLWAITSYNCPROC,                glWaitSync) \
+    _X(PFNGLCLIENTWAITSYNCPROC,          glClientWaitSync) \
+    _X(PFNGLDELETESYNCPROC,              glDeleteSync)
+
+// Frames rendered on the emulation thread are handed to the presentation thread through a
+// triple buffer. The shared index holds the most recently finished slot and a "new" flag,
+// both sides swap their own slot with it so each slot is always owned by exactly one thread.
+#define GL_HANDOFF_SLOTS 3
+#define GL_HANDOFF_INDEX_MASK 0x3
+#define GL_HANDOFF_NEW 0x4
+
+// Room for the fences of swaps that hard sync hasn't waited on yet. A fence that takes longer
+// than the timeout to signal is given up on.
+#define GL_SWAP_QUEUE 4
+#define GL_SWAP_TIMEOUT_NS 100000000ull
+
+// Counts the GL calls made while presenting so the per-frame cost can be checked.
+#define GL_COUNTED(_call) (g_gl.present_calls++, _call)
 
 static struct {
     bool initialized;
@@ -39,10 +68,58 @@ static struct {
     GLuint tex;
     GLuint fbo;
     float max_width, max_height;
+    // The letterboxed quad lives in the VBO and is only rewritten when the window or the
+    // frame size changes.
+    struct {
+        int window_width, window_height;
+        float frame_width, frame_height;
+        bool dirty;
+    } quad;
+    Uint64 presents;
+    Uint64 present_calls;
+    // With hard sync every swap is followed by a fence, the time from the start of the present
+    // until it signals is the present latency. All but the newest hard_sync of them are waited
+    // on so the driver can't queue more frames than that ahead of the GPU.
+    struct {
+        int hard_sync;
+        GLsync fence[GL_SWAP_QUEUE];
+        Uint64 start[GL_SWAP_QUEUE];
+        unsigned int head, tail;
+    } swaps;
+    // Software frames are converted straight into one of two pixel unpack buffers which is
+    // then uploaded to the same texture hardware cores render into.
+    struct {
+        bool enabled;
+        GLuint pbo[2];
+        int next;
+        size_t size;
+        void *mapped;
+    } sw;
+    struct {
+        bool enabled;
+        SDL_GLContext ctx;
+        GLuint vao;
+        GLuint tex[GL_HANDOFF_SLOTS];
+        GLuint fbo[GL_HANDOFF_SLOTS];
+        GLsync written[GL_HANDOFF_SLOTS];
+        GLsync presented[GL_HANDOFF_SLOTS];
+        float width[GL_HANDOFF_SLOTS];
+        float height[GL_HANDOFF_SLOTS];
+        int write;
+        int read;
+        GLuint bound_tex;
+        SDL_AtomicInt latest;
+    } handoff;
 } g_gl;
 
 static SDL_Window *g_gl_window;
 
+static void Gl_DrawFrame(GLuint vao, GLuint tex, float rw, float rh, bool shared);
+static bool Gl_UpdateQuad(float rw, float rh);
+static void Gl_SetSwapInterval(void);
+static void Gl_Swap(Uint64 start);
+static bool Gl_RetireSwap(bool wait);
+
 #define _X(_T, _n) _T _n;
 OPENGL_EXT_API_LIST
 #undef _X
@@ -84,6 +161,8 @@ bool Gl_Configure(int version_major, int version_minor, int max_width, int max_h
 
     g_gl.max_width = max_width;
     g_gl.max_height = max_height;
+    SDL_GetWindowSizeInPixels(g_gl_window, &g_gl.quad.window_width, &g_gl.quad.window_height);
+    g_gl.quad.dirty = true;
 
     SDL_assert_release(g_gl_window);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -91,6 +170,8 @@ bool Gl_Configure(int version_major, int version_minor, int max_width, int max_h
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, version_minor);
     if (!(g_gl.ctx = SDL_GL_CreateContext(g_gl_window))) return false;
     SDL_GL_MakeCurrent(g_gl_window, g_gl.ctx);
+    Gl_SetSwapInterval();
+    g_gl.swaps.hard_sync = Profile_GetHardSyncFrames();
 
     #define _X(_T, _n) if (!(_n = (_T)SDL_GL_GetProcAddress(#_n))) return false;
     OPENGL_EXT_API_LIST
@@ -100,6 +181,7 @@ bool Gl_Configure(int version_major, int version_minor, int max_width, int max_h
     glBindVertexArray(g_gl.vao);
     glGenBuffers(1, &g_gl.vbo);
     glBindBuffer(GL_ARRAY_BUFFER, g_gl.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * 6, 0, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 2, GL_FLOAT, 0, sizeof(float) * 4, 0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1, 2, GL_FLOAT, 0, sizeof(float) * 4, (void*)(sizeof(float) * 2));
@@ -143,7 +225,7 @@ bool Gl_Configure(int version_major, int version_minor, int max_width, int max_h
     glBindTexture(GL_TEXTURE_2D, g_gl.tex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, g_gl.max_width, g_gl.max_height, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, g_gl.max_width, g_gl.max_height, 0, GL_BGRA, GL_UNSIGNED_BYTE, 0);
     if (glGetError() != 0) return SDL_SetError("OpenGL error %d on line %d", glGetError(), __LINE__);
 
     glGenFramebuffers(1, &g_gl.fbo);
@@ -170,23 +252,400 @@ uint64_t Gl_GetFramebuffer(void)
     return g_gl.fbo;
 }
 
+void Gl_Finish(void)
+{
+    SDL_assert_release(g_gl.initialized);
+    glFinish();
+}
+
+bool Gl_StartSoftwareFrames(void)
+{
+    SDL_assert_release(g_gl.initialized && !g_gl.sw.enabled);
+
+    g_gl.sw.size = g_gl.max_width * g_gl.max_height * 4;
+    glGenBuffers(2, g_gl.sw.pbo);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_gl.sw.pbo[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, g_gl.sw.size, 0, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (glGetError() != 0) return SDL_SetError("OpenGL error %d on line %d", glGetError(), __LINE__);
+
+    // Software frames are stored top row first unlike what the core would render with OpenGL.
+    g_gl.sw.enabled = true;
+    g_gl.quad.dirty = true;
+
+    SDL_Log("uploading software rendered frames");
+    return true;
+}
+
+void *Gl_MapFrame(unsigned int width, unsigned int height, size_t *pitch)
+{
+    // The core renders straight into the next unpack buffer which stays mapped until the frame
+    // is uploaded, asking again before that returns the same memory.
+    if (!g_gl.sw.enabled || width > g_gl.max_width || height > g_gl.max_height)
+        return 0;
+
+    if (!g_gl.sw.mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_gl.sw.pbo[g_gl.sw.next]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, g_gl.sw.size, 0, GL_STREAM_DRAW);
+        g_gl.sw.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, g_gl.sw.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    *pitch = g_gl.max_width * 4;
+    return g_gl.sw.mapped;
+}
+
+void Gl_UploadFrame(pixel_format_t format, const void *data, unsigned int width, unsigned int height, size_t pitch)
+{
+    SDL_assert_release(g_gl.sw.enabled);
+
+    if (g_gl.sw.mapped)
+    {
+        // A core that was handed the mapped buffer but rendered somewhere else anyway only
+        // costs the unmap, its frame takes the regular path below.
+        bool own = data == g_gl.sw.mapped;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_gl.sw.pbo[g_gl.sw.next]);
+        bool ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        g_gl.sw.mapped = 0;
+
+        if (own)
+        {
+            if (ok)
+            {
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / 4);
+                glBindTexture(GL_TEXTURE_2D, g_gl.tex);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SDL_min(width, g_gl.max_width), SDL_min(height, g_gl.max_height), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            g_gl.sw.next ^= 1;
+            return;
+        }
+        g_gl.sw.next ^= 1;
+    }
+
+    // The buffer is orphaned before it is mapped so the driver can keep an upload that is
+    // still in flight going while the next frame is written, alternating between two of them
+    // covers drivers that wait anyway.
+    width = SDL_min(width, g_gl.max_width);
+    height = SDL_min(height, g_gl.max_height);
+    size_t size = width * height * 4;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_gl.sw.pbo[g_gl.sw.next]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, g_gl.sw.size, 0, GL_STREAM_DRAW);
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst)
+    {
+        Pixel_Convert(format, data, pitch, dst, width * 4, width, height);
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+        {
+            glBindTexture(GL_TEXTURE_2D, g_gl.tex);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    g_gl.sw.next ^= 1;
+}
+
+void Gl_Resize(int width, int height)
+{
+    g_gl.quad.window_width = width;
+    g_gl.quad.window_height = height;
+    g_gl.quad.dirty = true;
+}
+
+bool Gl_IsQuadDirty(void)
+{
+    return g_gl.quad.dirty;
+}
+
+double Gl_GetCallsPerPresent(void)
+{
+    return (g_gl.presents) ? ((double)g_gl.present_calls / g_gl.presents) : (0);
+}
+
 void *Gl_GetProcAddress(const char *sym)
 {
     SDL_assert_release(g_gl.initialized);
     return SDL_GL_GetProcAddress(sym);
 }
 
-void Gl_Present(float rw, float rh)
+bool Gl_StartThreadedPresent(void)
+{
+    SDL_assert_release(g_gl.initialized && !g_gl.handoff.enabled);
+
+    glGenTextures(GL_HANDOFF_SLOTS, g_gl.handoff.tex);
+    glGenFramebuffers(GL_HANDOFF_SLOTS, g_gl.handoff.fbo);
+    for (int i = 0; i < GL_HANDOFF_SLOTS; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, g_gl.handoff.tex[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, g_gl.max_width, g_gl.max_height, 0, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, g_gl.handoff.fbo[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_gl.handoff.tex[i], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) return SDL_SetError("OpenGL error %d on line %d", glGetError(), __LINE__);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glFlush();
+
+    // Vertex arrays are not shared between contexts so the presentation context needs its own.
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    g_gl.handoff.ctx = SDL_GL_CreateContext(g_gl_window);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+    if (!g_gl.handoff.ctx) return false;
+    Gl_SetSwapInterval();
+
+    glGenVertexArrays(1, &g_gl.handoff.vao);
+    glBindVertexArray(g_gl.handoff.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, g_gl.vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, 0, sizeof(float) * 4, 0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, 0, sizeof(float) * 4, (void*)(sizeof(float) * 2));
+    glEnableVertexAttribArray(1);
+    glUseProgram(g_gl.shader);
+    if (glGetError() != 0) return SDL_SetError("OpenGL error %d on line %d", glGetError(), __LINE__);
+
+    g_gl.quad.dirty = true;
+    g_gl.handoff.bound_tex = 0;
+    g_gl.handoff.write = 0;
+    g_gl.handoff.read = 1;
+    SDL_SetAtomicInt(&g_gl.handoff.latest, 2);
+    g_gl.handoff.enabled = true;
+
+    SDL_Log("presenting frames from a separate OpenGL context");
+    return SDL_ClearError();
+}
+
+void Gl_StopThreadedPresent(void)
+{
+    if (!g_gl.handoff.enabled)
+        return;
+
+    // The vertex array belongs to the presentation context, the framebuffers to the core's.
+    glDeleteVertexArrays(1, &g_gl.handoff.vao);
+    g_gl.handoff.vao = 0;
+    SDL_GL_DestroyContext(g_gl.handoff.ctx);
+    g_gl.handoff.ctx = 0;
+    g_gl.handoff.enabled = false;
+    Gl_AttachContext();
+
+    glDeleteFramebuffers(GL_HANDOFF_SLOTS, g_gl.handoff.fbo);
+    glDeleteTextures(GL_HANDOFF_SLOTS, g_gl.handoff.tex);
+    SDL_memset(g_gl.handoff.fbo, 0, sizeof(g_gl.handoff.fbo));
+    SDL_memset(g_gl.handoff.tex, 0, sizeof(g_gl.handoff.tex));
+
+    for (int i = 0; i < GL_HANDOFF_SLOTS; i++)
+    {
+        if (g_gl.handoff.written[i]) glDeleteSync(g_gl.handoff.written[i]);
+        if (g_gl.handoff.presented[i]) glDeleteSync(g_gl.handoff.presented[i]);
+        g_gl.handoff.written[i] = g_gl.handoff.presented[i] = 0;
+    }
+
+    for (; g_gl.swaps.tail != g_gl.swaps.head; g_gl.swaps.tail++)
+        glDeleteSync(g_gl.swaps.fence[g_gl.swaps.tail % GL_SWAP_QUEUE]);
+}
+
+void Gl_AttachContext(void)
 {
     SDL_assert_release(g_gl.initialized);
+    SDL_GL_MakeCurrent(g_gl_window, g_gl.ctx);
+}
+
+void Gl_DetachContext(void)
+{
+    SDL_GL_MakeCurrent(g_gl_window, 0);
+}
+
+void Gl_SubmitFrame(float rw, float rh)
+{
+    SDL_assert_release(g_gl.handoff.enabled);
+
+    int slot = g_gl.handoff.write;
+    if (g_gl.handoff.presented[slot])
+    {
+        glWaitSync(g_gl.handoff.presented[slot], 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(g_gl.handoff.presented[slot]);
+        g_gl.handoff.presented[slot] = 0;
+    }
 
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, g_gl.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, g_gl.handoff.fbo[slot]);
+    glBlitFramebuffer(0, 0, rw, rh, 0, 0, rw, rh, GL_COLOR_BUFFER_BIT, GL_NEAREST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    int ww, wh;
-    SDL_GetWindowSize(g_gl_window, &ww, &wh);
-    glViewport(0, 0, ww, wh);
+    // A slot that was published again before the main thread took it still has its old fence.
+    if (g_gl.handoff.written[slot]) glDeleteSync(g_gl.handoff.written[slot]);
+    g_gl.handoff.written[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    g_gl.handoff.width[slot] = rw;
+    g_gl.handoff.height[slot] = rh;
+    glFlush();
+
+    g_gl.handoff.write = SDL_SetAtomicInt(&g_gl.handoff.latest, slot | GL_HANDOFF_NEW) & GL_HANDOFF_INDEX_MASK;
+}
+
+bool Gl_PresentSubmittedFrame(void)
+{
+    SDL_assert_release(g_gl.handoff.enabled);
+
+    // Without a new frame the last one is drawn again after a resize so the back buffer isn't
+    // left stale until the core sends something new.
+    int slot = g_gl.handoff.read;
+    if (SDL_GetAtomicInt(&g_gl.handoff.latest) & GL_HANDOFF_NEW)
+    {
+        slot = g_gl.handoff.read = SDL_SetAtomicInt(&g_gl.handoff.latest, g_gl.handoff.read) & GL_HANDOFF_INDEX_MASK;
+        glWaitSync(g_gl.handoff.written[slot], 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(g_gl.handoff.written[slot]);
+        g_gl.handoff.written[slot] = 0;
+    }
+    else if (!g_gl.quad.dirty || !g_gl.handoff.width[slot])
+    {
+        return false;
+    }
+
+    if (g_gl.handoff.presented[slot]) glDeleteSync(g_gl.handoff.presented[slot]);
+
+    Trace_Begin("Gl_PresentSubmittedFrame");
+    Uint64 t0 = SDL_GetTicksNS();
+    Gl_DrawFrame(g_gl.handoff.vao, g_gl.handoff.tex[slot], g_gl.handoff.width[slot], g_gl.handoff.height[slot], false);
+    g_gl.handoff.presented[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    Trace_End("Gl_PresentSubmittedFrame");
+
+    Gl_Swap(t0);
+    return true;
+}
+
+void Gl_Present(float rw, float rh)
+{
+    SDL_assert_release(g_gl.initialized);
+
+    Trace_Begin("Gl_Present");
+    Uint64 t0 = SDL_GetTicksNS();
+    Gl_DrawFrame(g_gl.vao, g_gl.tex, rw, rh, true);
+    Trace_End("Gl_Present");
+
+    Gl_Swap(t0);
+}
+
+void Gl_SetSwapInterval(void)
+{
+    // The interval belongs to the current context so every context that swaps sets it.
+    switch (Profile_GetVsync())
+    {
+    case GL_VSYNC_DEFAULT:
+        return;
+
+    case GL_VSYNC_OFF:
+        SDL_GL_SetSwapInterval(0);
+        break;
+
+    case GL_VSYNC_ON:
+        SDL_GL_SetSwapInterval(1);
+        break;
+
+    case GL_VSYNC_ADAPTIVE:
+        if (!SDL_GL_SetSwapInterval(-1))
+        {
+            SDL_Log("adaptive vsync is not supported, falling back to regular vsync");
+            SDL_GL_SetSwapInterval(1);
+        }
+        break;
+    }
+
+    int interval = 0;
+    SDL_GL_GetSwapInterval(&interval);
+    SDL_Log("swap interval set to %d", interval);
+}
 
-    float wr = ww / (float)wh;
+void Gl_Swap(Uint64 start)
+{
+    Uint64 t = SDL_GetTicksNS();
+    Trace_Begin("SDL_GL_SwapWindow");
+    SDL_GL_SwapWindow(g_gl_window);
+    Trace_End("SDL_GL_SwapWindow");
+
+    if (g_gl.swaps.hard_sync >= 0)
+    {
+        unsigned int i = g_gl.swaps.head++ % GL_SWAP_QUEUE;
+        g_gl.swaps.fence[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        g_gl.swaps.start[i] = start;
+
+        Trace_Begin("Gl_HardSync");
+        while (g_gl.swaps.head - g_gl.swaps.tail > (unsigned int)g_gl.swaps.hard_sync)
+            Gl_RetireSwap(true);
+        Trace_End("Gl_HardSync");
+
+        while (g_gl.swaps.head != g_gl.swaps.tail && Gl_RetireSwap(false));
+    }
+
+    Stats_Record(STATS_STAGE_PRESENT, t - start);
+    Stats_Record(STATS_STAGE_SWAP, SDL_GetTicksNS() - t);
+}
+
+bool Gl_RetireSwap(bool wait)
+{
+    unsigned int i = g_gl.swaps.tail % GL_SWAP_QUEUE;
+    GLenum r = glClientWaitSync(g_gl.swaps.fence[i], GL_SYNC_FLUSH_COMMANDS_BIT, (wait) ? (GL_SWAP_TIMEOUT_NS) : (0));
+    if (r == GL_TIMEOUT_EXPIRED && !wait)
+        return false;
+
+    // A fence that had signaled before it was checked only says when it was checked unless it
+    // belongs to the swap that was just made.
+    bool newest = g_gl.swaps.tail + 1 == g_gl.swaps.head;
+    if (r == GL_CONDITION_SATISFIED || (r == GL_ALREADY_SIGNALED && newest))
+        Stats_Record(STATS_STAGE_LATENCY, SDL_GetTicksNS() - g_gl.swaps.start[i]);
+
+    glDeleteSync(g_gl.swaps.fence[i]);
+    g_gl.swaps.tail++;
+    return true;
+}
+
+void Gl_DrawFrame(GLuint vao, GLuint tex, float rw, float rh, bool shared)
+{
+    // In single-threaded mode the core renders with the same context and may leave any state
+    // behind so everything the draw depends on is set again. The presentation context of the
+    // threaded mode is only used here, its VAO and program are bound once when it is created.
+    g_gl.presents++;
+    bool rebuilt = Gl_UpdateQuad(rw, rh);
+
+    if (shared)
+    {
+        GL_COUNTED(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        GL_COUNTED(glBindVertexArray(vao));
+        GL_COUNTED(glUseProgram(g_gl.shader));
+        GL_COUNTED(glBindTexture(GL_TEXTURE_2D, tex));
+        GL_COUNTED(glClearColor(0, 0, 0, 0));
+    }
+    else if (tex != g_gl.handoff.bound_tex)
+    {
+        GL_COUNTED(glBindTexture(GL_TEXTURE_2D, tex));
+        g_gl.handoff.bound_tex = tex;
+    }
+
+    if (shared || rebuilt)
+        GL_COUNTED(glViewport(0, 0, g_gl.quad.window_width, g_gl.quad.window_height));
+
+    GL_COUNTED(glClear(GL_COLOR_BUFFER_BIT));
+    GL_COUNTED(glDrawArrays(GL_TRIANGLES, 0, 6));
+}
+
+bool Gl_UpdateQuad(float rw, float rh)
+{
+    if (!g_gl.quad.dirty && rw == g_gl.quad.frame_width && rh == g_gl.quad.frame_height)
+        return false;
+
+    g_gl.quad.frame_width = rw;
+    g_gl.quad.frame_height = rh;
+    g_gl.quad.dirty = false;
+
+    float ww = SDL_max(g_gl.quad.window_width, 1);
+    float wh = SDL_max(g_gl.quad.window_height, 1);
+
+    float wr = ww / wh;
     float rr = rw / (float)rh;
 
     float x, y, w, h;
@@ -213,24 +672,18 @@ void Gl_Present(float rw, float rh)
     float r = l + w / ww * 2;
     float b = t - h / wh * 2;
 
+    float vt = (g_gl.sw.enabled) ? (0) : (v);
+    float vb = (g_gl.sw.enabled) ? (v) : (0);
+
     float verts[] = {
-        l, t, 0, v,
-        r, t, u, v,
-        r, b, u, 0, 
-        l, t, 0, v,
-        r, b, u, 0, 
-        l, b, 0, 0, 
+        l, t, 0, vt,
+        r, t, u, vt,
+        r, b, u, vb,
+        l, t, 0, vt,
+        r, b, u, vb,
+        l, b, 0, vb,
     };
-    glBindBuffer(GL_ARRAY_BUFFER, g_gl.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
-
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glBindBuffer(GL_ARRAY_BUFFER, g_gl.vbo);
-    glBindVertexArray(g_gl.vao);
-    glBindTexture(GL_TEXTURE_2D, g_gl.tex);
-    glUseProgram(g_gl.shader);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    SDL_GL_SwapWindow(g_gl_window);
+    GL_COUNTED(glBindBuffer(GL_ARRAY_BUFFER, g_gl.vbo));
+    GL_COUNTED(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(verts), verts));
+    return true;
 }
@@ -4,10 +4,34 @@
 #include <SDL3/SDL_stdinc.h>
 #include <SDL3/SDL_opengl.h>
 
+#include "pixel.h"
+
+typedef enum gl_vsync_t gl_vsync_t;
+enum gl_vsync_t {
+    GL_VSYNC_DEFAULT,
+    GL_VSYNC_OFF,
+    GL_VSYNC_ON,
+    GL_VSYNC_ADAPTIVE,
+};
+
 void Gl_Init(SDL_Window *window);
 bool Gl_Configure(int version_major, int version_minor, int max_width, int max_height);
 
 uint64_t Gl_GetFramebuffer(void);
+void Gl_Finish(void);
 void *Gl_GetProcAddress(const char *sym);
 
 void Gl_Present(float w, float h);
+bool Gl_StartSoftwareFrames(void);
+void *Gl_MapFrame(unsigned int width, unsigned int height, size_t *pitch);
+void Gl_UploadFrame(pixel_format_t format, const void *data, unsigned int width, unsigned int height, size_t pitch);
+void Gl_Resize(int width, int height);
+bool Gl_IsQuadDirty(void);
+double Gl_GetCallsPerPresent(void);
+
+bool Gl_StartThreadedPresent(void);
+void Gl_StopThreadedPresent(void);
+void Gl_AttachContext(void);
+void Gl_DetachContext(void);
+void Gl_SubmitFrame(float w, float h);
+bool Gl_PresentSubmittedFrame(void);
@@ -0,0 +1,239 @@
+#include "hack.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_log.h>
+
+#define HACK_MAX_OPS 64
+
+typedef enum hack_op_type_t hack_op_type_t;
+enum hack_op_type_t {
+    HACK_OP_ARENA,
+    HACK_OP_GUARD,
+    HACK_OP_MOVE_X,
+    HACK_OP_MOVE_Y,
+};
+
+typedef enum hack_cond_t hack_cond_t;
+enum hack_cond_t {
+    HACK_COND_ALWAYS,
+    HACK_COND_ARENA,
+    HACK_COND_NOT_ARENA,
+};
+
+// Comparisons are inverted by negate ("!="), moves subtract instead of add.
+typedef struct hack_op_t hack_op_t;
+struct hack_op_t {
+    Uint8 type;
+    Uint8 cond;
+    Uint8 width;
+    bool negate;
+    Uint32 addr;
+    Uint32 value;
+};
+
+typedef struct hack_builtin_t hack_builtin_t;
+struct hack_builtin_t {
+    const char *name;
+    const char *program;
+};
+
+static const hack_builtin_t g_hack_builtins[] = {
+    // https://github.com/garungorp/MouseInjectorDolphinDuck/blob/master/games/ps1_acore.c
+    { "ac",
+        "guard u16 0x1AC80C != 0, guard u16 0x39AD4 != 0, guard u8 0x14C82B == 0, guard u8 0x1FE06E != 0x1A,"
+        "x u16 0x1A26CA -, y u16 0x411C0 +" },
+    // https://github.com/garungorp/MouseInjectorDolphinDuck/blob/master/games/ps1_acorepp.c
+    { "acpp",
+        "arena u32 0x1D1D20 == 0x801D1CC8,"
+        "!arena: guard u8 0x1A7FAC != 0, guard u8 0x3BA14 != 0, !arena: guard u8 0x1555EB == 0,"
+        "arena: x u16 0x1D1D32 -, !arena: x u16 0x1E2DF2 -, y u16 0x42708 +" },
+    // https://github.com/GoldenLumia/MouseInjectorDolphinDuck/blob/master/games%2Fps1_acoremoa.c
+    { "acmoa",
+        "arena u32 0x1D8C70 == 0x801A6E80,"
+        "!arena: guard u8 0x1BA72C != 0, guard u8 0x3E720 != 0,"
+        "arena: x u16 0x1D8C1A -, !arena: x u16 0x1E725A -, y u16 0x453B0 +" },
+};
+
+static struct {
+    Uint8 *ram;
+    size_t ram_size;
+    unsigned int count;
+    hack_op_t ops[HACK_MAX_OPS];
+} g_hack;
+
+static bool   Hack_CompileStatement(char *statement, hack_op_t *op);
+static bool   Hack_ParseNumber(const char *token, Uint32 *value);
+static Uint32 Hack_Read(const hack_op_t *op);
+static void   Hack_Write(const hack_op_t *op, Uint32 value);
+
+const char *Hack_GetBuiltin(const char *name)
+{
+    for (size_t i = 0; i < SDL_arraysize(g_hack_builtins); i++)
+        if (SDL_strcmp(g_hack_builtins[i].name, name) == 0)
+            return g_hack_builtins[i].program;
+    return 0;
+}
+
+bool Hack_Compile(const char *program, Uint8 *ram, size_t ram_size)
+{
+    Hack_Free();
+    SDL_assert_release(program && ram);
+
+    char *text = SDL_strdup(program);
+    if (!text)
+        return SDL_SetError("failed to allocate mouse hack program");
+
+    for (char *c = text; (c = SDL_strchr(c, '#')); )
+        while (*c && *c != '\n') *c++ = ' ';
+
+    bool ok = true;
+    char *save;
+    for (char *s = SDL_strtok_r(text, ",\r\n", &save); s && ok; s = SDL_strtok_r(0, ",\r\n", &save))
+    {
+        while (*s == ' ' || *s == '\t') s++;
+        if (!*s) continue;
+
+        if (g_hack.count == HACK_MAX_OPS)
+        {
+            ok = SDL_SetError("mouse hack has more than %d statements", HACK_MAX_OPS);
+            break;
+        }
+
+        hack_op_t *op = &g_hack.ops[g_hack.count++];
+        if (!Hack_CompileStatement(s, op))
+            ok = false;
+        else if (op->addr > ram_size || op->width > ram_size - op->addr)
+            ok = SDL_SetError("mouse hack address 0x%X is outside of the %zu bytes of RAM", op->addr, ram_size);
+    }
+
+    SDL_free(text);
+    if (!ok)
+    {
+        Hack_Free();
+        return false;
+    }
+
+    g_hack.ram = ram;
+    g_hack.ram_size = ram_size;
+    SDL_Log("compiled mouse hack into %u ops", g_hack.count);
+    return true;
+}
+
+void Hack_Free(void)
+{
+    SDL_memset(&g_hack, 0, sizeof(g_hack));
+}
+
+void Hack_Apply(float dx, float dy)
+{
+    if (!g_hack.ram)
+        return;
+
+    bool arena = false;
+    for (unsigned int i = 0; i < g_hack.count; i++)
+    {
+        const hack_op_t *op = &g_hack.ops[i];
+        if ((op->cond == HACK_COND_ARENA && !arena) || (op->cond == HACK_COND_NOT_ARENA && arena))
+            continue;
+
+        switch (op->type)
+        {
+        case HACK_OP_ARENA:
+            arena = (Hack_Read(op) == op->value) != op->negate;
+            break;
+
+        case HACK_OP_GUARD:
+            if ((Hack_Read(op) == op->value) == op->negate) return;
+            break;
+
+        case HACK_OP_MOVE_X:
+        case HACK_OP_MOVE_Y:
+        {
+            // Same truncation as writing the float result into the integer directly.
+            double d = (op->type == HACK_OP_MOVE_X) ? (dx) : (dy);
+            Hack_Write(op, (Uint32)(Sint64)((double)Hack_Read(op) + ((op->negate) ? (-d) : (d))));
+            break;
+        }
+        }
+    }
+}
+
+bool Hack_CompileStatement(char *statement, hack_op_t *op)
+{
+    SDL_memset(op, 0, sizeof(*op));
+
+    char *save;
+    char *t[6] = {0};
+    int n = 0;
+    for (char *s = SDL_strtok_r(statement, " \t", &save); s; s = SDL_strtok_r(0, " \t", &save))
+    {
+        if (n == (int)SDL_arraysize(t)) return SDL_SetError("unexpected \"%s\" in mouse hack statement", s);
+        t[n++] = s;
+    }
+
+    if      (n && SDL_strcmp(t[0], "arena:") == 0) op->cond = HACK_COND_ARENA;
+    else if (n && SDL_strcmp(t[0], "!arena:") == 0) op->cond = HACK_COND_NOT_ARENA;
+    if (op->cond != HACK_COND_ALWAYS)
+        SDL_memmove(t, t + 1, sizeof(t[0]) * --n);
+
+    if (n < 3) return SDL_SetError("incomplete mouse hack statement starting with \"%s\"", (n) ? (t[0]) : (""));
+
+    if      (SDL_strcmp(t[0], "arena") == 0) op->type = HACK_OP_ARENA;
+    else if (SDL_strcmp(t[0], "guard") == 0) op->type = HACK_OP_GUARD;
+    else if (SDL_strcmp(t[0], "x") == 0) op->type = HACK_OP_MOVE_X;
+    else if (SDL_strcmp(t[0], "y") == 0) op->type = HACK_OP_MOVE_Y;
+    else return SDL_SetError("unknown mouse hack statement \"%s\" (only \"arena\", \"guard\", \"x\" and \"y\" are allowed)", t[0]);
+
+    if      (SDL_strcmp(t[1], "u8") == 0) op->width = 1;
+    else if (SDL_strcmp(t[1], "u16") == 0) op->width = 2;
+    else if (SDL_strcmp(t[1], "u32") == 0) op->width = 4;
+    else return SDL_SetError("invalid mouse hack width \"%s\" (only \"u8\", \"u16\" and \"u32\" are allowed)", t[1]);
+
+    if (!Hack_ParseNumber(t[2], &op->addr)) return SDL_SetError("invalid mouse hack address \"%s\"", t[2]);
+
+    if (op->type == HACK_OP_MOVE_X || op->type == HACK_OP_MOVE_Y)
+    {
+        if (n != 4 || (SDL_strcmp(t[3], "+") != 0 && SDL_strcmp(t[3], "-") != 0))
+            return SDL_SetError("mouse hack \"%s\" statement at 0x%X needs a \"+\" or \"-\" sign", t[0], op->addr);
+        op->negate = t[3][0] == '-';
+        return true;
+    }
+
+    if (n != 5 || (SDL_strcmp(t[3], "==") != 0 && SDL_strcmp(t[3], "!=") != 0))
+        return SDL_SetError("mouse hack \"%s\" statement at 0x%X needs \"==\" or \"!=\" and a value", t[0], op->addr);
+    op->negate = t[3][0] == '!';
+    if (!Hack_ParseNumber(t[4], &op->value)) return SDL_SetError("invalid mouse hack value \"%s\"", t[4]);
+    return true;
+}
+
+bool Hack_ParseNumber(const char *token, Uint32 *value)
+{
+    char *end;
+    unsigned long long v = SDL_strtoull(token, &end, 0);
+    *value = v;
+    return *token && !*end && v <= 0xFFFFFFFFu;
+}
+
+Uint32 Hack_Read(const hack_op_t *op)
+{
+    const Uint8 *p = g_hack.ram + op->addr;
+    Uint8 v8; Uint16 v16; Uint32 v32;
+    switch (op->width)
+    {
+    case 1: SDL_memcpy(&v8, p, 1); return v8;
+    case 2: SDL_memcpy(&v16, p, 2); return v16;
+    default: SDL_memcpy(&v32, p, 4); return v32;
+    }
+}
+
+void Hack_Write(const hack_op_t *op, Uint32 value)
+{
+    Uint8 *p = g_hack.ram + op->addr;
+    Uint8 v8 = value; Uint16 v16 = value;
+    switch (op->width)
+    {
+    case 1: SDL_memcpy(p, &v8, 1); break;
+    case 2: SDL_memcpy(p, &v16, 2); break;
+    default: SDL_memcpy(p, &value, 4); break;
+    }
+}
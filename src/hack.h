@@ -0,0 +1,20 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+// Mouse hacks turn mouse motion into writes to the camera angles in emulated RAM. They are
+// written as a list of statements separated by commas or new lines, run in order every frame:
+//
+//     arena <width> <address> <==|!=> <value>   remembers whether the game is in the arena
+//     guard <width> <address> <==|!=> <value>   stops unless the comparison holds
+//     x <width> <address> <+|->                 adds or subtracts horizontal motion
+//     y <width> <address> <+|->                 adds or subtracts vertical motion
+//
+// Width is one of u8, u16 or u32. A statement prefixed with "arena:" or "!arena:" only runs
+// when the game is or isn't in the arena, everything after a # up to the end of the line is
+// ignored. The program is compiled against the RAM it patches once and can't change after.
+
+const char *Hack_GetBuiltin(const char *name);
+bool        Hack_Compile(const char *program, Uint8 *ram, size_t ram_size);
+void        Hack_Free(void);
+void        Hack_Apply(float dx, float dy);
@@ -7,34 +7,121 @@
 #include <SDL3/SDL_opengl_glext.h>
 
 #include "gl.h"
+#include "perf.h"
 #include "core.h"
+#include "ring.h"
+#include "pacer.h"
+#include "autosave.h"
+#include "rewind.h"
+#include "stats.h"
+#include "trace.h"
+#include "scan.h"
+#include "bind.h"
 #include "profile.h"
 
 #define FPS_DISPLAY_UPDATE_PERIOD 0.5f
+#define PAUSED_SLEEP_PERIOD_MS 10
+#define INPUT_QUEUE_SIZE 1024
+#define INPUT_PEEP_BATCH 64
+#define DEFERRED_INPUT_COUNT 16
+
+typedef enum app_input_type_t app_input_type_t;
+enum app_input_type_t {
+    APP_INPUT_JOYPAD,
+    APP_INPUT_ANALOG,
+    APP_INPUT_MOUSE_MOVE,
+    APP_INPUT_REWIND,
+    APP_INPUT_FAST_FORWARD,
+    APP_INPUT_SCAN_START,
+    APP_INPUT_SCAN_FILTER,
+};
+
+typedef struct app_input_t app_input_t;
+struct app_input_t {
+    app_input_type_t type;
+    uint8_t axis;
+    int16_t value;
+    float dx, dy;
+    Uint64 timestamp;
+};
 
 static struct {
     SDL_Window *window;
-    Uint64 last_frame_tick;
-    Uint64 frame_time_acc;
-    Uint64 frame_acc_count;
+    Uint64 last_frame_start;
     Uint64 last_fps_update_time;
+    Uint64 last_fps_frame_count;
     Uint64 last_autosave_time;
+    Uint64 event_timestamp;
+    // Timestamp of the oldest joypad or mouse input applied since the core last polled, 0 when
+    // there was none.
+    Uint64 oldest_input;
+    // Motion is scaled per event and summed up until the core polls, which only takes whole
+    // units and leaves the fraction for the next frame.
+    struct {
+        float x, y;
+        Uint64 last_time;
+    } mouse;
+    // Scan requests touch emulated RAM so they wait until the frame that polled them is done.
+    struct {
+        app_input_t inputs[DEFERRED_INPUT_COUNT];
+        unsigned int count;
+    } deferred;
+    bool rewinding;
+    bool rewind_held;
+    bool fast_forward_latched;
+    struct {
+        unsigned int frames;
+        const char *state_path;
+    } bench;
+    struct {
+        bool enabled;
+        SDL_Thread *thread;
+        SDL_Semaphore *frame_ready;
+        SDL_AtomicInt quit;
+        SDL_AtomicInt paused;
+        ring_t input;
+        app_input_t input_buffer[INPUT_QUEUE_SIZE];
+    } threaded;
 } g_app;
 
 static bool ApplyProfile(void);
+static void WaitForFrame(void);
+static void EmulateFrame(void);
+static void PollInput(void);
+static void PollBenchInput(void);
+static void SkipFrames(void);
+static int  EmulationThread(void *userdata);
+static void HandleAction(bind_action_t action, bool pressed);
+static void SendInput(app_input_t in);
+static void ApplyInput(const app_input_t *in);
+static void ApplyDeferredInputs(void);
+static bool IsFrameInputEvent(const SDL_Event *event);
+static void SetJoypadAxis(uint8_t axis, int16_t value);
+static void AddMouseMotion(float dx, float dy, Uint64 timestamp);
+static void ResetFrameStats(void);
+static void UpdateTitle(Uint64 tick);
+static SDL_AppResult RunBenchmark(void);
+static int  CompareFrameTimes(const void *a, const void *b);
 
 SDL_AppResult SDL_AppInit(void **userdata, int argc, char **argv)
 {
     SDL_SetAppMetadata("Emulator", "0.1.0", "com.xfnty.libretro-frontend");
 
-    if (argc != 2)
+    if (argc >= 4 && argc <= 5 && SDL_strcmp(argv[2], "--bench") == 0)
     {
-        SDL_SetError("Usage: emu <profile.cfg>");
+        g_app.bench.frames = SDL_strtoul(argv[3], 0, 10);
+        g_app.bench.state_path = (argc == 5) ? (argv[4]) : (0);
+    }
+
+    if (argc != 2 && !g_app.bench.frames)
+    {
+        SDL_SetError("Usage: emu <profile.cfg> [--bench <frames> [savestate]]");
         return SDL_APP_FAILURE;
     }
 
-    if (!Profile_Load(argv[1]))
+    if (!Profile_Load(argv[1]) || !Bind_Init() || !Trace_Init())
         return SDL_APP_FAILURE;
+    Trace_NameThread("main");
 
     SDL_InitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS);
 
@@ -47,67 +134,90 @@ SDL_AppResult SDL_AppInit(void **userdata, int argc, char **argv)
     if (!Core_Load(Profile_GetCorePath()) || !Core_LoadGame(Profile_GetGamePath()))
         return SDL_APP_FAILURE;
 
-    Core_LoadState(Profile_GetAutosavePath());
+    if (!Autosave_Init())
+        return SDL_APP_FAILURE;
+
+    if (!Core_SetMouseHack(Profile_GetMouseHack()))
+        return SDL_APP_FAILURE;
+
+    if (g_app.bench.frames)
+    {
+        Core_SetInputPollCallback(PollBenchInput);
+        Core_SetAudioMuted(true);
+        const char *state = (g_app.bench.state_path) ? (g_app.bench.state_path) : (Profile_GetAutosavePath());
+        return (Autosave_Load(state)) ? (SDL_APP_CONTINUE) : (SDL_APP_FAILURE);
+    }
+
+    Autosave_Load(Profile_GetAutosavePath());
+
+    if (!Rewind_Init())
+        return SDL_APP_FAILURE;
 
-    Core_SetMouseHackProfile(Profile_GetMouseHackProfile());
+    Core_SetInputPollCallback(PollInput);
     SDL_SetWindowRelativeMouseMode(g_app.window, true);
 
+    Pacer_Init(Core_GetTargetFPS());
+
+    if (Profile_IsThreaded())
+    {
+        Ring_Init(&g_app.threaded.input, g_app.threaded.input_buffer, sizeof(app_input_t), INPUT_QUEUE_SIZE);
+        if (!Gl_StartThreadedPresent()) return SDL_APP_FAILURE;
+        if (!(g_app.threaded.frame_ready = SDL_CreateSemaphore(0))) return SDL_APP_FAILURE;
+        g_app.threaded.enabled = true;
+        if (!(g_app.threaded.thread = SDL_CreateThread(EmulationThread, "emulation", 0))) return SDL_APP_FAILURE;
+    }
+
+    ResetFrameStats();
     SDL_ShowWindow(g_app.window);
     return SDL_APP_CONTINUE;
 }
 
 SDL_AppResult SDL_AppIterate(void *userdata)
 {
-    if (!(SDL_GetWindowFlags(g_app.window) & SDL_WINDOW_INPUT_FOCUS))
-    {
-        g_app.last_fps_update_time = SDL_GetTicks() - FPS_DISPLAY_UPDATE_PERIOD * 1000;
-        g_app.frame_time_acc = 0;
-        g_app.frame_acc_count = 0;
-        return SDL_APP_CONTINUE;
-    }
+    if (g_app.bench.frames)
+        return RunBenchmark();
 
-    Uint64 tick = SDL_GetTicks();
+    bool focused = SDL_GetWindowFlags(g_app.window) & SDL_WINDOW_INPUT_FOCUS;
 
-    if ((tick - g_app.last_frame_tick) / 1000.0 >= 1 / Core_GetTargetFPS())
+    if (g_app.threaded.enabled)
     {
-        if (SDL_GetWindowRelativeMouseMode(g_app.window))
+        SDL_SetAtomicInt(&g_app.threaded.paused, !focused);
+        if (!focused)
         {
-            float mx, my;
-            SDL_GetRelativeMouseState(&mx, &my);
-            Core_SetMouseMove(mx * Profile_GetMouseSensitivityX(), my * Profile_GetMouseSensitivityY());
+            ResetFrameStats();
+            SDL_Delay(PAUSED_SLEEP_PERIOD_MS);
+            return SDL_APP_CONTINUE;
         }
 
-        Core_RunFrame();
-        Gl_Present(Core_GetRenderWidth(), Core_GetRenderHeight());
-        g_app.last_frame_tick = tick;
-        g_app.frame_time_acc += SDL_GetTicks() - tick;
-        g_app.frame_acc_count++;
+        SDL_WaitSemaphoreTimeout(g_app.threaded.frame_ready, PAUSED_SLEEP_PERIOD_MS);
+        Gl_PresentSubmittedFrame();
+        UpdateTitle(SDL_GetTicksNS());
+        return SDL_APP_CONTINUE;
     }
 
-    if (tick - g_app.last_fps_update_time >= FPS_DISPLAY_UPDATE_PERIOD * 1000)
+    if (!focused)
     {
-        float ms = g_app.frame_time_acc / (float)g_app.frame_acc_count;
-        char b[128];
-        SDL_snprintf(b, sizeof(b), "%.0f ms (%d FPS)", ms, (int)(1.0f / (ms / 1000.0f)));
-        SDL_SetWindowTitle(g_app.window, b);
-        g_app.last_fps_update_time = tick;
-        g_app.frame_time_acc = 0;
-        g_app.frame_acc_count = 0;
+        ResetFrameStats();
+        Pacer_Reset();
+        g_app.last_frame_start = 0;
+        SDL_Delay(PAUSED_SLEEP_PERIOD_MS);
+        return SDL_APP_CONTINUE;
     }
 
-    if (tick - g_app.last_autosave_time >= Profile_GetAutosavePeriod() * 1000)
-    {
-        if (!Core_SaveState(Profile_GetAutosavePath()))
-            SDL_Log("autosave failed, retrying after %.0f seconds", Profile_GetAutosavePeriod());
-
-        g_app.last_autosave_time = tick;
-    }
+    WaitForFrame();
+    EmulateFrame();
+    // A resize also redraws the last frame, the core may keep sending duplicates for a while.
+    if (Core_HasNewFrame() || (Gl_IsQuadDirty() && Core_GetRenderWidth()))
+        Gl_Present(Core_GetRenderWidth(), Core_GetRenderHeight());
+    UpdateTitle(SDL_GetTicksNS());
 
     return SDL_APP_CONTINUE;
 }
 
 SDL_AppResult SDL_AppEvent(void *userdata, SDL_Event *event)
 {
+    g_app.event_timestamp = event->common.timestamp;
+
     switch (event->type)
     {
     case SDL_EVENT_QUIT:
@@ -117,47 +227,25 @@ SDL_AppResult SDL_AppEvent(void *userdata, SDL_Event *event)
         SDL_SetWindowTitle(g_app.window, "Paused");
         break;
 
+    case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+        Gl_Resize(event->window.data1, event->window.data2);
+        break;
+
     case SDL_EVENT_KEY_UP:
     case SDL_EVENT_KEY_DOWN:
-        if (event->type == SDL_EVENT_KEY_DOWN && !event->key.repeat)
-        {
-            if (event->key.key == SDLK_F11)
-            {
-                SDL_SetWindowFullscreen(g_app.window, !(SDL_GetWindowFlags(g_app.window) & SDL_WINDOW_FULLSCREEN));
-            }
-            else if (event->key.key == SDLK_ESCAPE)
-            {
-                SDL_SetWindowRelativeMouseMode(g_app.window, !SDL_GetWindowRelativeMouseMode(g_app.window));
-            }
-        }
-
-        if      (event->key.key == SDLK_W)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_UP,     event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_S)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_DOWN,   event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_D)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_R,      event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_A)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_L,      event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_I)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_L2,     event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_K)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_R2,     event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_J)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_LEFT,   event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_L)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_RIGHT,  event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_X)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_A,      event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_N)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_A,      event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_M)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_Y,      event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_SPACE)     Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_B,      event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_BACKSPACE) Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_SELECT, event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_RETURN)    Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_START,  event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_M)         Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_Y,      event->type == SDL_EVENT_KEY_DOWN);
-        else if (event->key.key == SDLK_TAB)       Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_X,      event->type == SDL_EVENT_KEY_DOWN);
+        if (!event->key.repeat)
+            HandleAction(Bind_GetKeyAction(event->key.scancode), event->type == SDL_EVENT_KEY_DOWN);
         break;
 
     case SDL_EVENT_MOUSE_BUTTON_UP:
     case SDL_EVENT_MOUSE_BUTTON_DOWN:
-        if (event->button.button == SDL_BUTTON_LEFT)
-        {
-            Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_Y, event->type == SDL_EVENT_MOUSE_BUTTON_DOWN);
-        }
-        else if (event->button.button == SDL_BUTTON_RIGHT)
+        HandleAction(Bind_GetMouseAction(event->button.button), event->type == SDL_EVENT_MOUSE_BUTTON_DOWN);
+        break;
+
+    case SDL_EVENT_MOUSE_MOTION:
+        if (SDL_GetWindowRelativeMouseMode(g_app.window))
         {
-            Core_SetJoypadAxis(RETRO_DEVICE_ID_JOYPAD_X, event->type == SDL_EVENT_MOUSE_BUTTON_DOWN);
+            SendInput((app_input_t){ .type = APP_INPUT_MOUSE_MOVE, .dx = event->motion.xrel, .dy = event->motion.yrel });
         }
         break;
     }
@@ -167,12 +255,442 @@ SDL_AppResult SDL_AppEvent(void *userdata, SDL_Event *event)
 
 void SDL_AppQuit(void *userdata, SDL_AppResult result)
 {
-    Core_SaveState(Profile_GetAutosavePath());
+    if (g_app.threaded.thread)
+    {
+        SDL_SetAtomicInt(&g_app.threaded.quit, 1);
+        SDL_WaitThread(g_app.threaded.thread, 0);
+        Gl_StopThreadedPresent();
+        SDL_DestroySemaphore(g_app.threaded.frame_ready);
+        g_app.threaded.thread = 0;
+        g_app.threaded.enabled = false;
+    }
+
+    if (Pacer_GetFrameCount())
+        SDL_Log("pacer missed %llu of %llu frame deadlines", (unsigned long long)Pacer_GetMissCount(), (unsigned long long)Pacer_GetFrameCount());
+    if (Pacer_GetAverageFrameDelay())
+        SDL_Log("frames were delayed by %.2f ms on average", Pacer_GetAverageFrameDelay());
+    if (Pacer_GetFrameCount() && (Core_GetAudioUnderrunCount() || Core_GetAudioOverrunCount()))
+        SDL_Log("audio queue ran dry %llu times and overfilled %llu times", (unsigned long long)Core_GetAudioUnderrunCount(), (unsigned long long)Core_GetAudioOverrunCount());
+    if (Gl_GetCallsPerPresent())
+        SDL_Log("%.1f GL calls per presented frame", Gl_GetCallsPerPresent());
+    Stats_Log();
+
+    Rewind_Free();
+    Scan_Free();
+    if (!g_app.bench.frames) Autosave_Save(true);
+    Autosave_Free();
     Core_Free();
-    
+    Trace_Free();
+
     if (result == SDL_APP_FAILURE)
     {
         SDL_Log("%s", SDL_GetError());
         while (1);
     }
 }
+
+void WaitForFrame(void)
+{
+    // Frame time is measured between consecutive frame starts so it includes everything the
+    // loop did, idle is the part of it that was spent waiting for the deadline.
+    Uint64 t = SDL_GetTicksNS();
+    Pacer_Wait();
+    Uint64 now = SDL_GetTicksNS();
+
+    Stats_Record(STATS_STAGE_IDLE, now - t);
+    if (g_app.last_frame_start)
+        Stats_Record(STATS_STAGE_FRAME, now - g_app.last_frame_start);
+    g_app.last_frame_start = now;
+}
+
+void EmulateFrame(void)
+{
+    Trace_Begin("EmulateFrame");
+    Uint64 t = SDL_GetTicksNS();
+
+    if (Core_IsFastForwarding() && !g_app.rewinding)
+        SkipFrames();
+
+    if (g_app.rewinding && Rewind_IsEnabled())
+    {
+        // Without a state to step back to the last frame is held and shown again instead of
+        // running on and recording new history over the state being rewound to. Input is still
+        // taken so the release of the rewind key isn't missed, and audio is muted so that the
+        // pacer runs by its timer while the core produces none.
+        bool held = !Rewind_StepBack();
+        if (held != g_app.rewind_held) Core_SetAudioMuted(held);
+        g_app.rewind_held = held;
+        if (!held) Core_RunFrame();
+        else PollInput();
+    }
+    else
+    {
+        if (g_app.rewind_held) Core_SetAudioMuted(false);
+        g_app.rewind_held = false;
+        Core_RunFrame();
+        Rewind_Capture();
+    }
+    ApplyDeferredInputs();
+
+    Uint64 tick = SDL_GetTicks();
+    if (tick - g_app.last_autosave_time >= Profile_GetAutosavePeriod() * 1000)
+    {
+        if (!Autosave_Save(false))
+            SDL_Log("autosave failed, retrying after %.0f seconds", Profile_GetAutosavePeriod());
+
+        g_app.last_autosave_time = tick;
+    }
+
+    if (!Core_IsFastForwarding())
+        Pacer_RecordWork(SDL_GetTicksNS() - t);
+    Trace_End("EmulateFrame");
+}
+
+void SkipFrames(void)
+{
+    // Shown frames stay on the pacer's schedule, the frames fast-forward adds run in between
+    // them with video and audio disabled. Without a ratio frames are skipped for half of the
+    // frame period and the rest of it is left for the shown frame.
+    unsigned int ratio = Profile_GetFastForwardRatio();
+    Uint64 budget = SDL_NS_PER_SECOND / Core_GetTargetFPS() / 2;
+    for (unsigned int i = 1; (ratio) ? (i < ratio) : (SDL_GetTicksNS() - g_app.last_frame_start < budget); i++)
+        Core_SkipFrame();
+}
+
+int EmulationThread(void *userdata)
+{
+    // The core keeps rendering into the context it was loaded with, the main thread presents
+    // from a second context that shares its textures.
+    Trace_NameThread("emulation");
+    Gl_AttachContext();
+
+    while (!SDL_GetAtomicInt(&g_app.threaded.quit))
+    {
+        if (SDL_GetAtomicInt(&g_app.threaded.paused))
+        {
+            Pacer_Reset();
+            g_app.last_frame_start = 0;
+            SDL_Delay(PAUSED_SLEEP_PERIOD_MS);
+            continue;
+        }
+
+        WaitForFrame();
+        EmulateFrame();
+        if (Core_HasNewFrame()) Gl_SubmitFrame(Core_GetRenderWidth(), Core_GetRenderHeight());
+        SDL_SignalSemaphore(g_app.threaded.frame_ready);
+    }
+
+    Gl_DetachContext();
+    return 0;
+}
+
+void PollInput(void)
+{
+    // Called from within the frame once the core asks for input so it sees everything that
+    // arrived until then. The emulation thread takes what the main thread has queued for it.
+    if (!g_app.threaded.enabled)
+    {
+        // Events are only pumped between frames, but input that SDL has queued since then from
+        // its own threads is taken as long as it's joypad or mouse input. The first event of
+        // any other kind stops it so nothing is dispatched out of order, hotkeys wait until
+        // the frame is done.
+        SDL_Event events[INPUT_PEEP_BATCH];
+        int n, taken;
+        do
+        {
+            n = SDL_PeepEvents(events, INPUT_PEEP_BATCH, SDL_PEEKEVENT, SDL_EVENT_KEY_DOWN, SDL_EVENT_MOUSE_REMOVED);
+            for (taken = 0; taken < n && IsFrameInputEvent(&events[taken]); taken++);
+            if (taken) SDL_PeepEvents(events, taken, SDL_GETEVENT, SDL_EVENT_KEY_DOWN, SDL_EVENT_MOUSE_REMOVED);
+            for (int i = 0; i < taken; i++)
+                SDL_AppEvent(0, &events[i]);
+        }
+        while (taken == INPUT_PEEP_BATCH);
+    }
+    else
+    {
+        app_input_t in;
+        while (Ring_Read(&g_app.threaded.input, &in, 1))
+            ApplyInput(&in);
+    }
+
+    Uint64 now = SDL_GetTicksNS();
+    if (g_app.oldest_input && g_app.oldest_input < now)
+        Stats_Record(STATS_STAGE_INPUT, now - g_app.oldest_input);
+    g_app.oldest_input = 0;
+
+    // Mouse motion is dropped while rewinding instead of being applied to the restored state.
+    float mx = SDL_truncf(g_app.mouse.x);
+    float my = SDL_truncf(g_app.mouse.y);
+    if (!g_app.rewinding)
+    {
+        Core_SetMouseMove(mx, my);
+        g_app.mouse.x -= mx;
+        g_app.mouse.y -= my;
+    }
+    else
+    {
+        g_app.mouse.x = g_app.mouse.y = 0;
+    }
+}
+
+void PollBenchInput(void)
+{
+    // Runs the mouse hack without motion so the benchmark does the same work as normal play.
+    Core_SetMouseMove(0, 0);
+}
+
+void HandleAction(bind_action_t action, bool pressed)
+{
+    if (action >= BIND_ACTION_JOYPAD_B && action <= BIND_ACTION_JOYPAD_R3)
+    {
+        SetJoypadAxis(action - BIND_ACTION_JOYPAD_B, pressed);
+        return;
+    }
+
+    if (action >= BIND_ACTION_ANALOG_LX_MINUS && action <= BIND_ACTION_ANALOG_RY_PLUS)
+    {
+        SendInput((app_input_t){ .type = APP_INPUT_ANALOG, .axis = action - BIND_ACTION_ANALOG_LX_MINUS, .value = pressed });
+        return;
+    }
+
+    if (action >= BIND_ACTION_SCAN_CHANGED && action <= BIND_ACTION_SCAN_EQUAL)
+    {
+        if (pressed) SendInput((app_input_t){ .type = APP_INPUT_SCAN_FILTER, .axis = SCAN_FILTER_CHANGED + (action - BIND_ACTION_SCAN_CHANGED) });
+        return;
+    }
+
+    switch (action)
+    {
+    case BIND_ACTION_FULLSCREEN:
+        if (pressed) SDL_SetWindowFullscreen(g_app.window, !(SDL_GetWindowFlags(g_app.window) & SDL_WINDOW_FULLSCREEN));
+        break;
+
+    case BIND_ACTION_MOUSE_CAPTURE:
+        if (pressed) SDL_SetWindowRelativeMouseMode(g_app.window, !SDL_GetWindowRelativeMouseMode(g_app.window));
+        break;
+
+    case BIND_ACTION_STATS:
+        if (!pressed) break;
+        Stats_Log();
+        if (Gl_GetCallsPerPresent()) SDL_Log("%.1f GL calls per presented frame", Gl_GetCallsPerPresent());
+        Perf_Log();
+        break;
+
+    case BIND_ACTION_TRACE:
+        if (pressed && !Trace_Dump()) SDL_Log("failed to write trace: %s", SDL_GetError());
+        break;
+
+    case BIND_ACTION_REWIND:
+        SendInput((app_input_t){ .type = APP_INPUT_REWIND, .value = pressed });
+        break;
+
+    case BIND_ACTION_FAST_FORWARD:
+        if (!Profile_IsFastForwardToggle())
+            SendInput((app_input_t){ .type = APP_INPUT_FAST_FORWARD, .value = pressed });
+        else if (pressed)
+            SendInput((app_input_t){ .type = APP_INPUT_FAST_FORWARD, .value = (g_app.fast_forward_latched = !g_app.fast_forward_latched) });
+        break;
+
+    case BIND_ACTION_SCAN_START:
+        if (pressed) SendInput((app_input_t){ .type = APP_INPUT_SCAN_START });
+        break;
+
+    default:
+        break;
+    }
+}
+
+void SendInput(app_input_t in)
+{
+    in.timestamp = g_app.event_timestamp;
+    if (!g_app.threaded.enabled)
+        ApplyInput(&in);
+    else if (!Ring_Write(&g_app.threaded.input, &in, 1))
+        SDL_Log("input queue is full, dropped input event %d", in.type);
+}
+
+void ApplyInput(const app_input_t *in)
+{
+    if (in->type == APP_INPUT_JOYPAD || in->type == APP_INPUT_ANALOG || in->type == APP_INPUT_MOUSE_MOVE)
+        g_app.oldest_input = (g_app.oldest_input) ? (SDL_min(g_app.oldest_input, in->timestamp)) : (in->timestamp);
+
+    switch (in->type)
+    {
+    case APP_INPUT_JOYPAD:
+        Core_SetJoypadAxis(in->axis, in->value);
+        break;
+
+    case APP_INPUT_ANALOG:
+        Core_SetAnalogDirection(in->axis, in->value);
+        break;
+
+    case APP_INPUT_MOUSE_MOVE:
+        AddMouseMotion(in->dx, in->dy, in->timestamp);
+        break;
+
+    case APP_INPUT_REWIND:
+        g_app.rewinding = in->value;
+        break;
+
+    case APP_INPUT_FAST_FORWARD:
+        Core_SetFastForward(in->value);
+        break;
+
+    case APP_INPUT_SCAN_START:
+    case APP_INPUT_SCAN_FILTER:
+        if (g_app.deferred.count < DEFERRED_INPUT_COUNT)
+            g_app.deferred.inputs[g_app.deferred.count++] = *in;
+        else
+            SDL_Log("too many deferred inputs, dropped input event %d", in->type);
+        break;
+    }
+}
+
+void ApplyDeferredInputs(void)
+{
+    for (unsigned int i = 0; i < g_app.deferred.count; i++)
+    {
+        const app_input_t *in = &g_app.deferred.inputs[i];
+        if (in->type == APP_INPUT_SCAN_START)
+        {
+            size_t size;
+            Uint8 *ram = Core_GetSystemRam(&size);
+            if (!ram || !Scan_Start(ram, size, Profile_GetScanWidth() / 8))
+                SDL_Log("failed to start RAM scan: %s", SDL_GetError());
+        }
+        else if (!Scan_Filter(in->axis, Profile_GetScanValue()))
+        {
+            SDL_Log("failed to filter RAM scan: %s", SDL_GetError());
+        }
+    }
+    g_app.deferred.count = 0;
+}
+
+bool IsFrameInputEvent(const SDL_Event *event)
+{
+    bind_action_t action;
+    switch (event->type)
+    {
+    case SDL_EVENT_MOUSE_MOTION:
+        return true;
+    case SDL_EVENT_KEY_DOWN:
+    case SDL_EVENT_KEY_UP:
+        action = Bind_GetKeyAction(event->key.scancode);
+        break;
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+        action = Bind_GetMouseAction(event->button.button);
+        break;
+    default:
+        return false;
+    }
+    return action >= BIND_ACTION_JOYPAD_B && action <= BIND_ACTION_ANALOG_RY_PLUS;
+}
+
+void SetJoypadAxis(uint8_t axis, int16_t value)
+{
+    SendInput((app_input_t){ .type = APP_INPUT_JOYPAD, .axis = axis, .value = value });
+}
+
+void AddMouseMotion(float dx, float dy, Uint64 timestamp)
+{
+    // Acceleration depends on the speed of each event on its own so it doesn't change with
+    // how many of them arrive per frame.
+    float gain = 1;
+    float accel = Profile_GetMouseAcceleration();
+    if (accel > 0 && g_app.mouse.last_time && timestamp > g_app.mouse.last_time)
+    {
+        float speed = SDL_sqrtf(dx * dx + dy * dy) / ((timestamp - g_app.mouse.last_time) / 1e6f);
+        gain = 1 + accel * speed;
+        if (Profile_GetMouseAccelerationCap() > 0) gain = SDL_min(gain, Profile_GetMouseAccelerationCap());
+    }
+    g_app.mouse.last_time = timestamp;
+
+    g_app.mouse.x += dx * gain * Profile_GetMouseSensitivityX();
+    g_app.mouse.y += dy * gain * Profile_GetMouseSensitivityY();
+}
+
+void ResetFrameStats(void)
+{
+    g_app.last_fps_update_time = SDL_GetTicksNS();
+    g_app.last_fps_frame_count = Stats_GetCount(STATS_STAGE_FRAME);
+}
+
+void UpdateTitle(Uint64 tick)
+{
+    // Percentiles cover the whole session, the frame rate only the last update period.
+    Uint64 elapsed = tick - g_app.last_fps_update_time;
+    if (elapsed < FPS_DISPLAY_UPDATE_PERIOD * SDL_NS_PER_SECOND)
+        return;
+
+    Uint64 frames = Stats_GetCount(STATS_STAGE_FRAME);
+    double fps = (frames - g_app.last_fps_frame_count) / (elapsed / 1e9);
+    g_app.last_fps_update_time = tick;
+    g_app.last_fps_frame_count = frames;
+
+    // Present latency is only measured with hard sync.
+    char latency[48] = "";
+    if (Stats_GetCount(STATS_STAGE_LATENCY))
+        SDL_snprintf(latency, sizeof(latency), ", present latency %.1f ms", Stats_GetPercentile(STATS_STAGE_LATENCY, 50) / 1e6);
+
+    char b[224];
+    SDL_snprintf(
+        b, sizeof(b),
+        "%.0f FPS, frame p50 %.2f ms, p99 %.2f ms, run p99 %.2f ms, %llu missed%s, audio %.0f ms (%llu underruns)",
+        fps,
+        Stats_GetPercentile(STATS_STAGE_FRAME, 50) / 1e6,
+        Stats_GetPercentile(STATS_STAGE_FRAME, 99) / 1e6,
+        Stats_GetPercentile(STATS_STAGE_RUN, 99) / 1e6,
+        (unsigned long long)Pacer_GetMissCount(),
+        latency,
+        Core_GetAudioLatency(),
+        (unsigned long long)Core_GetAudioUnderrunCount()
+    );
+    SDL_SetWindowTitle(g_app.window, b);
+}
+
+SDL_AppResult RunBenchmark(void)
+{
+    // Each frame is waited on with glFinish() so that the measured time includes the GPU work
+    // the core submitted instead of however much of it the driver decided to queue.
+    unsigned int n = g_app.bench.frames;
+    Uint64 *times = SDL_malloc(n * sizeof(Uint64));
+    if (!times)
+    {
+        SDL_SetError("failed to allocate benchmark results");
+        return SDL_APP_FAILURE;
+    }
+
+    SDL_Log("running %u frames uncapped", n);
+
+    Uint64 start = SDL_GetTicksNS();
+    for (unsigned int i = 0; i < n; i++)
+    {
+        Uint64 t = SDL_GetTicksNS();
+        Core_RunFrame();
+        Gl_Finish();
+        times[i] = SDL_GetTicksNS() - t;
+    }
+    Uint64 total = SDL_GetTicksNS() - start;
+
+    SDL_qsort(times, n, sizeof(Uint64), CompareFrameTimes);
+    SDL_Log(
+        "%u frames in %.3f s: %.1f FPS, mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms",
+        n,
+        total / 1e9,
+        n / (total / 1e9),
+        total / 1e6 / n,
+        times[n / 2] / 1e6,
+        times[(Uint64)n * 99 / 100] / 1e6,
+        times[n - 1] / 1e6
+    );
+
+    SDL_free(times);
+    return SDL_APP_SUCCESS;
+}
+
+int CompareFrameTimes(const void *a, const void *b)
+{
+    Uint64 x = *(const Uint64*)a, y = *(const Uint64*)b;
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,169 @@
+#include "pacer.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_timer.h>
+
+#include "core.h"
+#include "profile.h"
+
+// Frames that start later than this behind their deadline are not caught up on, the schedule
+// is moved forward instead so that the pacer does not run a burst of frames back to back.
+#define PACER_MAX_LAG_FRAMES 1
+// A frame only counts as missed when it starts later than this fraction of the period, sleep
+// overshoot and vsync jitter of a few microseconds are not worth reporting.
+#define PACER_MISS_TOLERANCE 0.25
+#define PACER_AUDIO_POLL_NS (250 * SDL_NS_PER_US)
+
+// Waiting for the audio queue to drain gives up after this many frame periods and paces by the
+// timer until the device catches up again, so a stalled or removed device can't freeze the app.
+#define PACER_AUDIO_MAX_WAIT_FRAMES 2
+
+// Frame delay predicts the work of the next frame as the longest of the last
+// PACER_WORK_WINDOW frames and leaves PACER_FRAME_DELAY_SLACK_NS on top of it for presenting.
+#define PACER_WORK_WINDOW 32
+#define PACER_FRAME_DELAY_SLACK_NS (1 * SDL_NS_PER_MS)
+
+static struct {
+    Uint64 period;
+    Uint64 sleep_margin;
+    Uint64 deadline;
+    Uint64 frames;
+    Uint64 misses;
+    bool audio_driven;
+    bool audio_stalled;
+    struct {
+        bool enabled;
+        Uint64 delay;
+        Uint64 work[PACER_WORK_WINDOW];
+        unsigned int next;
+        Uint64 total;
+        Uint64 frames;
+    } frame_delay;
+} g_pacer;
+
+void Pacer_Init(double fps)
+{
+    SDL_assert_release(fps > 0);
+    SDL_memset(&g_pacer, 0, sizeof(g_pacer));
+    g_pacer.period = SDL_NS_PER_SECOND / fps;
+    g_pacer.sleep_margin = Profile_GetPacerSleepMargin() * SDL_NS_PER_MS;
+    g_pacer.audio_driven = Profile_IsAudioPacingEnabled();
+    g_pacer.frame_delay.enabled = Profile_IsFrameDelayEnabled() && !g_pacer.audio_driven;
+
+    // The delay is taken from the pacer's own schedule which knows nothing about vblank, with
+    // a swap that waits for it a frame started later could miss it and be shown a refresh late.
+    if (g_pacer.frame_delay.enabled && Profile_GetVsync() != GL_VSYNC_OFF)
+    {
+        SDL_Log("frame delay needs video.vsync set to \"off\", disabling it");
+        g_pacer.frame_delay.enabled = false;
+    }
+
+    if (g_pacer.audio_driven)
+        SDL_Log("pacing frames by audio queue depth (%.1f ms)", Core_GetAudioTargetLatency());
+    else
+        SDL_Log("pacing frames every %.3f ms (sleep margin %.2f ms%s)", g_pacer.period / 1e6, g_pacer.sleep_margin / 1e6, (g_pacer.frame_delay.enabled) ? (", auto frame delay") : (""));
+}
+
+void Pacer_Reset(void)
+{
+    g_pacer.deadline = 0;
+}
+
+void Pacer_Wait(void)
+{
+    SDL_assert_release(g_pacer.period);
+
+    // Fast-forward drops audio so the queue can't be used to pace frames while it lasts.
+    if (g_pacer.audio_driven && !Core_IsFastForwarding() && Core_IsAudioPlaying())
+    {
+        if (g_pacer.audio_stalled && Core_GetAudioLatency() <= Core_GetAudioTargetLatency())
+        {
+            SDL_Log("audio queue is draining again, pacing frames by audio");
+            g_pacer.audio_stalled = false;
+        }
+
+        // The next frame is run once the device has played the queue down to the target, so
+        // emulation follows the audio clock instead of the system timer.
+        Uint64 limit = SDL_GetTicksNS() + g_pacer.period * PACER_AUDIO_MAX_WAIT_FRAMES;
+        while (!g_pacer.audio_stalled && Core_GetAudioLatency() > Core_GetAudioTargetLatency())
+        {
+            if (SDL_GetTicksNS() >= limit)
+            {
+                SDL_Log("audio queue stopped draining, pacing frames by timer");
+                g_pacer.audio_stalled = true;
+                g_pacer.deadline = 0;
+                g_pacer.misses++;
+                break;
+            }
+            SDL_DelayNS(PACER_AUDIO_POLL_NS);
+        }
+
+        if (!g_pacer.audio_stalled)
+        {
+            g_pacer.frames++;
+            return;
+        }
+    }
+
+    // Frame delay keeps the schedule but starts each frame late into its period, as late as
+    // the predicted work still fits, so input is sampled closer to when the frame is shown.
+    // Skipped frames need the whole period so it is not applied while fast-forwarding.
+    Uint64 delay = (g_pacer.frame_delay.enabled && !Core_IsFastForwarding()) ? (g_pacer.frame_delay.delay) : (0);
+    Uint64 now = SDL_GetTicksNS();
+
+    if (!g_pacer.deadline)
+    {
+        g_pacer.deadline = now;
+    }
+    else if (now >= g_pacer.deadline + delay)
+    {
+        if (now - (g_pacer.deadline + delay) > g_pacer.period * PACER_MISS_TOLERANCE)
+            g_pacer.misses++;
+        if (now - g_pacer.deadline > g_pacer.period * PACER_MAX_LAG_FRAMES)
+            g_pacer.deadline = now;
+    }
+    else
+    {
+        Uint64 start = g_pacer.deadline + delay;
+        if (start - now > g_pacer.sleep_margin)
+            SDL_DelayNS(start - now - g_pacer.sleep_margin);
+
+        while (SDL_GetTicksNS() < start)
+            SDL_CPUPauseInstruction();
+
+        g_pacer.frame_delay.total += delay;
+        g_pacer.frame_delay.frames++;
+    }
+
+    g_pacer.deadline += g_pacer.period;
+    g_pacer.frames++;
+}
+
+void Pacer_RecordWork(Uint64 ns)
+{
+    if (!g_pacer.frame_delay.enabled)
+        return;
+
+    g_pacer.frame_delay.work[g_pacer.frame_delay.next++ % PACER_WORK_WINDOW] = ns;
+
+    Uint64 predicted = PACER_FRAME_DELAY_SLACK_NS;
+    for (int i = 0; i < PACER_WORK_WINDOW; i++)
+        predicted = SDL_max(predicted, g_pacer.frame_delay.work[i] + PACER_FRAME_DELAY_SLACK_NS);
+
+    g_pacer.frame_delay.delay = (g_pacer.period > predicted) ? (g_pacer.period - predicted) : (0);
+}
+
+double Pacer_GetAverageFrameDelay(void)
+{
+    return (g_pacer.frame_delay.frames) ? (g_pacer.frame_delay.total / 1e6 / g_pacer.frame_delay.frames) : (0);
+}
+
+Uint64 Pacer_GetFrameCount(void)
+{
+    return g_pacer.frames;
+}
+
+Uint64 Pacer_GetMissCount(void)
+{
+    return g_pacer.misses;
+}
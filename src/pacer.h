@@ -0,0 +1,12 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+void   Pacer_Init(double fps);
+void   Pacer_Reset(void);
+void   Pacer_Wait(void);
+void   Pacer_RecordWork(Uint64 ns);
+double Pacer_GetAverageFrameDelay(void);
+
+Uint64 Pacer_GetFrameCount(void);
+Uint64 Pacer_GetMissCount(void);
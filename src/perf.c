@@ -0,0 +1,120 @@
+#include "perf.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_timer.h>
+#include <SDL3/SDL_cpuinfo.h>
+
+#include "stats.h"
+
+#define PERF_MAX_COUNTERS 128
+
+// The counters live in the core's memory, the table only points at them and has to be reset
+// before the core is unloaded.
+static struct {
+    struct retro_perf_counter *counters[PERF_MAX_COUNTERS];
+    unsigned int count;
+    Uint64 cpu_features;
+} g_perf;
+
+static retro_time_t      Perf_GetTimeUsec(void);
+static uint64_t          Perf_GetCpuFeatures(void);
+static retro_perf_tick_t Perf_GetCounter(void);
+static void              Perf_Register(struct retro_perf_counter *counter);
+static void              Perf_Start(struct retro_perf_counter *counter);
+static void              Perf_Stop(struct retro_perf_counter *counter);
+
+void Perf_GetInterface(struct retro_perf_callback *cb)
+{
+    cb->get_time_usec = Perf_GetTimeUsec;
+    cb->get_cpu_features = Perf_GetCpuFeatures;
+    cb->get_perf_counter = Perf_GetCounter;
+    cb->perf_register = Perf_Register;
+    cb->perf_start = Perf_Start;
+    cb->perf_stop = Perf_Stop;
+    cb->perf_log = Perf_Log;
+}
+
+void Perf_Reset(void)
+{
+    SDL_memset(&g_perf, 0, sizeof(g_perf));
+}
+
+void Perf_Log(void)
+{
+    if (!g_perf.count)
+        return;
+
+    // Frames are counted by retro_run() calls so counters that only tick inside the core's
+    // frame can be read as a per-frame cost.
+    double frames = SDL_max(Stats_GetCount(STATS_STAGE_RUN), 1);
+    double ms_per_tick = 1000.0 / SDL_GetPerformanceFrequency();
+
+    SDL_Log("%-32s %10s %12s %10s %12s", "core counter", "calls", "total ms", "calls/fr", "us/frame");
+    for (unsigned int i = 0; i < g_perf.count; i++)
+    {
+        const struct retro_perf_counter *c = g_perf.counters[i];
+        SDL_Log(
+            "%-32s %10llu %12.2f %10.2f %12.2f",
+            c->ident,
+            (unsigned long long)c->call_cnt,
+            c->total * ms_per_tick,
+            c->call_cnt / frames,
+            c->total * ms_per_tick * 1000.0 / frames
+        );
+    }
+}
+
+retro_time_t Perf_GetTimeUsec(void)
+{
+    return SDL_GetTicksNS() / SDL_NS_PER_US;
+}
+
+uint64_t Perf_GetCpuFeatures(void)
+{
+    if (g_perf.cpu_features)
+        return g_perf.cpu_features;
+
+    Uint64 f = 0;
+    if (SDL_HasMMX())     f |= RETRO_SIMD_MMX;
+    if (SDL_HasSSE())     f |= RETRO_SIMD_SSE;
+    if (SDL_HasSSE2())    f |= RETRO_SIMD_SSE2;
+    if (SDL_HasSSE3())    f |= RETRO_SIMD_SSE3;
+    if (SDL_HasSSE41())   f |= RETRO_SIMD_SSE4;
+    if (SDL_HasSSE42())   f |= RETRO_SIMD_SSE42;
+    if (SDL_HasAVX())     f |= RETRO_SIMD_AVX;
+    if (SDL_HasAVX2())    f |= RETRO_SIMD_AVX2;
+    if (SDL_HasNEON())    f |= RETRO_SIMD_NEON;
+    if (SDL_HasAltiVec()) f |= RETRO_SIMD_VMX;
+    return g_perf.cpu_features = f;
+}
+
+retro_perf_tick_t Perf_GetCounter(void)
+{
+    return SDL_GetPerformanceCounter();
+}
+
+void Perf_Register(struct retro_perf_counter *counter)
+{
+    if (counter->registered)
+        return;
+
+    if (g_perf.count == PERF_MAX_COUNTERS)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "too many perf counters, \"%s\" is not tracked", counter->ident);
+        return;
+    }
+
+    g_perf.counters[g_perf.count++] = counter;
+    counter->registered = true;
+}
+
+void Perf_Start(struct retro_perf_counter *counter)
+{
+    counter->call_cnt++;
+    counter->start = SDL_GetPerformanceCounter();
+}
+
+void Perf_Stop(struct retro_perf_counter *counter)
+{
+    counter->total += SDL_GetPerformanceCounter() - counter->start;
+}
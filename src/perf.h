@@ -0,0 +1,9 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+#include "libretro.h"
+
+void Perf_GetInterface(struct retro_perf_callback *cb);
+void Perf_Reset(void);
+void Perf_Log(void);
@@ -0,0 +1,100 @@
+#include "pixel.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_intrin.h>
+
+static void Pixel_ConvertRow565(const Uint16 *src, Uint32 *dst, unsigned int count);
+static void Pixel_ConvertRow1555(const Uint16 *src, Uint32 *dst, unsigned int count);
+
+void Pixel_Convert(pixel_format_t format, const void *src, size_t src_pitch, void *dst, size_t dst_pitch, unsigned int width, unsigned int height)
+{
+    const Uint8 *s = src;
+    Uint8 *d = dst;
+
+    if (format == PIXEL_FORMAT_XRGB8888 && src_pitch == dst_pitch)
+    {
+        SDL_memcpy(d, s, dst_pitch * height);
+        return;
+    }
+
+    for (unsigned int y = 0; y < height; y++, s += src_pitch, d += dst_pitch)
+    {
+        switch (format)
+        {
+        case PIXEL_FORMAT_XRGB8888: SDL_memcpy(d, s, width * 4); break;
+        case PIXEL_FORMAT_RGB565:   Pixel_ConvertRow565((const Uint16*)s, (Uint32*)d, width); break;
+        case PIXEL_FORMAT_0RGB1555: Pixel_ConvertRow1555((const Uint16*)s, (Uint32*)d, width); break;
+        }
+    }
+}
+
+// Channels are widened by replicating their top bits into the new low bits so that full
+// intensity maps to 0xFF. The SIMD paths do 8 pixels at a time in 16-bit lanes and then
+// interleave (B | G << 8) with (R | 0xFF << 8) into 32-bit pixels.
+
+void Pixel_ConvertRow565(const Uint16 *src, Uint32 *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#ifdef SDL_SSE2_INTRINSICS
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i mask6 = _mm_set1_epi16(0x3F);
+    const __m128i alpha = _mm_set1_epi16((short)0xFF00);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i r = _mm_srli_epi16(p, 11);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+        __m128i b = _mm_and_si128(p, mask5);
+        r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+        g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+        b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+        __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        __m128i rx = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi16(bg, rx));
+        _mm_storeu_si128((__m128i*)(dst + i + 4), _mm_unpackhi_epi16(bg, rx));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        Uint32 r = src[i] >> 11, g = (src[i] >> 5) & 0x3F, b = src[i] & 0x1F;
+        r = (r << 3) | (r >> 2);
+        g = (g << 2) | (g >> 4);
+        b = (b << 3) | (b >> 2);
+        dst[i] = 0xFF000000u | (r << 16) | (g << 8) | b;
+    }
+}
+
+void Pixel_ConvertRow1555(const Uint16 *src, Uint32 *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#ifdef SDL_SSE2_INTRINSICS
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i alpha = _mm_set1_epi16((short)0xFF00);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i r = _mm_and_si128(_mm_srli_epi16(p, 10), mask5);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask5);
+        __m128i b = _mm_and_si128(p, mask5);
+        r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+        g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+        b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+        __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        __m128i rx = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi16(bg, rx));
+        _mm_storeu_si128((__m128i*)(dst + i + 4), _mm_unpackhi_epi16(bg, rx));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        Uint32 r = (src[i] >> 10) & 0x1F, g = (src[i] >> 5) & 0x1F, b = src[i] & 0x1F;
+        r = (r << 3) | (r >> 2);
+        g = (g << 3) | (g >> 2);
+        b = (b << 3) | (b >> 2);
+        dst[i] = 0xFF000000u | (r << 16) | (g << 8) | b;
+    }
+}
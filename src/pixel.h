@@ -0,0 +1,14 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+// Pixel formats a core can hand over software frames in, all of them are converted to
+// XRGB8888 which is stored as B, G, R, X bytes.
+typedef enum pixel_format_t pixel_format_t;
+enum pixel_format_t {
+    PIXEL_FORMAT_0RGB1555,
+    PIXEL_FORMAT_XRGB8888,
+    PIXEL_FORMAT_RGB565,
+};
+
+void Pixel_Convert(pixel_format_t format, const void *src, size_t src_pitch, void *dst, size_t dst_pitch, unsigned int width, unsigned int height);
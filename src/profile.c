@@ -7,6 +7,22 @@
 #define INI_IMPLEMENTATION
 #include "ini.h"
 #include "libretro.h"
+#include "hack.h"
+
+#define DEFAULT_PACER_SLEEP_MARGIN 1.0f
+#define MAX_RUN_AHEAD_FRAMES 8
+#define DEFAULT_REWIND_INTERVAL 1
+#define DEFAULT_AUDIO_LATENCY 64.0f
+#define MAX_HARD_SYNC_FRAMES 1
+#define DEFAULT_SCAN_WIDTH 16
+
+// Key-value pairs of a table whose keys aren't known in advance.
+typedef struct profile_pairs_t profile_pairs_t;
+struct profile_pairs_t {
+    unsigned int count;
+    char **names;
+    char **values;
+};
 
 static struct {
     ini_t ini;
@@ -15,28 +31,44 @@ static struct {
     char save[256];
     char autosave[256];
     char system[256];
+    char trace[256];
     bool fullscreen;
+    bool threaded;
+    gl_vsync_t vsync;
+    int hard_sync_frames;
+    bool audio_ring;
+    bool audio_rate_control;
+    bool audio_pacing;
+    float audio_latency;
     float mouse_sensitivity_x;
     float mouse_sensitivity_y;
-    core_mouse_hack_t mouse_hack_profile;
+    float mouse_acceleration;
+    float mouse_acceleration_cap;
+    char *mouse_hack;
     float autosave_period;
-    struct {
-        unsigned int count;
-        char **names;
-        char **values;
-    } vars;
+    float pacer_sleep_margin;
+    bool frame_delay;
+    unsigned int run_ahead_frames;
+    unsigned int fast_forward_ratio;
+    bool fast_forward_toggle;
+    unsigned int rewind_budget;
+    unsigned int rewind_interval;
+    unsigned int scan_width;
+    unsigned int scan_value;
+    profile_pairs_t bindings;
+    profile_pairs_t vars;
 } g_profile;
 
+static double Profile_ReadNum(initable_t *table, const char *key, double fallback);
+static void   Profile_ReadPairs(initable_t *table, profile_pairs_t *pairs);
+static void   Profile_FreePairs(profile_pairs_t *pairs);
+
 bool Profile_Load(const char *path)
 {
     ini_free(&g_profile.ini);
-    for (unsigned int i = 0; i < g_profile.vars.count; i++)
-    {
-        SDL_free(g_profile.vars.names[i]);
-        SDL_free(g_profile.vars.values[i]);
-    }
-    SDL_free(g_profile.vars.names);
-    SDL_free(g_profile.vars.values);
+    Profile_FreePairs(&g_profile.bindings);
+    Profile_FreePairs(&g_profile.vars);
+    SDL_free(g_profile.mouse_hack);
     SDL_memset(&g_profile, 0, sizeof(g_profile));
     SDL_ClearError();
 
@@ -58,29 +90,79 @@ bool Profile_Load(const char *path)
     initable_t *input = ini_get_table(&g_profile.ini, "input");
     if (!(g_profile.mouse_sensitivity_x = ini_as_num(ini_get(input, "mouse_sensitivity_x")))) return SDL_SetError("missing or zeroed field \"input.mouse_sensitivity_x\" in profile \"%s\"", path);
     if (!(g_profile.mouse_sensitivity_y = ini_as_num(ini_get(input, "mouse_sensitivity_y")))) return SDL_SetError("missing or zeroed field \"input.mouse_sensitivity_y\" in profile \"%s\"", path);
-    char profile_name[256];
-    if (!ini_to_str(ini_get(input, "mouse_hack_for"), profile_name, sizeof(profile_name), false)) return SDL_SetError("missing field \"input.mouse_hack_for\" in profile \"%s\"", path);
-    if      (SDL_strcmp(profile_name, "ac") == 0) g_profile.mouse_hack_profile = CORE_MOUSE_HACK_AC;
-    else if (SDL_strcmp(profile_name, "acpp") == 0) g_profile.mouse_hack_profile = CORE_MOUSE_HACK_AC_PROJECT_PHANTASMA;
-    else if (SDL_strcmp(profile_name, "acmoa") == 0) g_profile.mouse_hack_profile = CORE_MOUSE_HACK_AC_MASTER_OF_ARENA;
-    else return SDL_SetError("field \"input.mouse_hack_for\" has invalid value of \"%s\" (only \"ac\", \"acpp\" and \"acmoa\" are allowed)", profile_name);
+    g_profile.mouse_acceleration = ini_as_num(ini_get(input, "mouse_acceleration"));
+    if (g_profile.mouse_acceleration < 0) return SDL_SetError("field \"input.mouse_acceleration\" can not be negative in profile \"%s\"", path);
+    g_profile.mouse_acceleration_cap = ini_as_num(ini_get(input, "mouse_acceleration_cap"));
+    if (g_profile.mouse_acceleration_cap < 0) return SDL_SetError("field \"input.mouse_acceleration_cap\" can not be negative in profile \"%s\"", path);
+    // A mouse hack written into the profile or a file takes precedence over the built-in ones.
+    char hack_path[256];
+    char hack_name[256];
+    inivalue_t *hack = ini_get(input, "mouse_hack");
+    if (hack && hack->value.len)
+    {
+        // Copied in full since an inline hack has no reasonable upper bound on its length.
+        g_profile.mouse_hack = SDL_strndup(hack->value.buf, hack->value.len);
+    }
+    else if (ini_to_str(ini_get(input, "mouse_hack_file"), hack_path, sizeof(hack_path), false) > 0)
+    {
+        if (!(g_profile.mouse_hack = SDL_LoadFile(hack_path, 0))) return SDL_SetError("failed to load mouse hack \"%s\": %s", hack_path, SDL_GetError());
+    }
+    else if (ini_to_str(ini_get(input, "mouse_hack_for"), hack_name, sizeof(hack_name), false) > 0)
+    {
+        if (!Hack_GetBuiltin(hack_name)) return SDL_SetError("field \"input.mouse_hack_for\" has invalid value of \"%s\" (only \"ac\", \"acpp\" and \"acmoa\" are allowed)", hack_name);
+        g_profile.mouse_hack = SDL_strdup(Hack_GetBuiltin(hack_name));
+    }
+    else
+    {
+        return SDL_SetError("missing field \"input.mouse_hack_for\" in profile \"%s\"", path);
+    }
+    if (!g_profile.mouse_hack) return SDL_SetError("failed to allocate mouse hack");
 
     g_profile.fullscreen = ini_as_bool(ini_get(general, "fullscreen"));
+    g_profile.threaded = ini_as_bool(ini_get(general, "threaded"));
 
-    initable_t *vars = ini_get_table(&g_profile.ini, "vars");
-    if (vars)
-    {
-        g_profile.vars.count = ivec_len(vars->values);
-        g_profile.vars.names = SDL_calloc(g_profile.vars.count, sizeof(g_profile.vars.names[0]));
-        g_profile.vars.values = SDL_calloc(g_profile.vars.count, sizeof(g_profile.vars.values[0]));
-        for (unsigned int i = 0; i < g_profile.vars.count; i++)
-        {
-            inivalue_t v = vars->values[i];
-            g_profile.vars.names[i] = SDL_strndup(v.key.buf, v.key.len);
-            g_profile.vars.values[i] = SDL_strndup(v.value.buf, v.value.len);
-            // SDL_Log("%s=%s", g_profile.vars.names[i], g_profile.vars.values[i], i);
-        }
-    }
+    initable_t *video = ini_get_table(&g_profile.ini, "video");
+    char vsync[16] = "";
+    ini_to_str(ini_get(video, "vsync"), vsync, sizeof(vsync), false);
+    if      (!*vsync) g_profile.vsync = GL_VSYNC_DEFAULT;
+    else if (SDL_strcmp(vsync, "off") == 0) g_profile.vsync = GL_VSYNC_OFF;
+    else if (SDL_strcmp(vsync, "on") == 0) g_profile.vsync = GL_VSYNC_ON;
+    else if (SDL_strcmp(vsync, "adaptive") == 0) g_profile.vsync = GL_VSYNC_ADAPTIVE;
+    else return SDL_SetError("field \"video.vsync\" has invalid value of \"%s\" (only \"off\", \"on\" and \"adaptive\" are allowed)", vsync);
+    g_profile.hard_sync_frames = Profile_ReadNum(video, "hard_sync_frames", -1);
+    if (g_profile.hard_sync_frames < -1 || g_profile.hard_sync_frames > MAX_HARD_SYNC_FRAMES) return SDL_SetError("field \"video.hard_sync_frames\" can only be 0 or %d in profile \"%s\"", MAX_HARD_SYNC_FRAMES, path);
+
+    initable_t *timing = ini_get_table(&g_profile.ini, "timing");
+    g_profile.pacer_sleep_margin = Profile_ReadNum(timing, "pacer_sleep_margin", DEFAULT_PACER_SLEEP_MARGIN);
+    if (g_profile.pacer_sleep_margin < 0) return SDL_SetError("field \"timing.pacer_sleep_margin\" can not be negative in profile \"%s\"", path);
+    g_profile.frame_delay = ini_as_bool(ini_get(timing, "frame_delay"));
+    g_profile.run_ahead_frames = ini_as_uint(ini_get(timing, "run_ahead_frames"));
+    if (g_profile.run_ahead_frames > MAX_RUN_AHEAD_FRAMES) return SDL_SetError("field \"timing.run_ahead_frames\" can not be larger than %d in profile \"%s\"", MAX_RUN_AHEAD_FRAMES, path);
+
+    g_profile.fast_forward_ratio = ini_as_uint(ini_get(timing, "fast_forward_ratio"));
+    g_profile.fast_forward_toggle = ini_as_bool(ini_get(timing, "fast_forward_toggle"));
+
+    initable_t *rewind = ini_get_table(&g_profile.ini, "rewind");
+    g_profile.rewind_budget = ini_as_uint(ini_get(rewind, "budget"));
+    g_profile.rewind_interval = SDL_clamp(Profile_ReadNum(rewind, "interval", DEFAULT_REWIND_INTERVAL), 1, SDL_MAX_UINT32);
+
+    initable_t *audio = ini_get_table(&g_profile.ini, "audio");
+    g_profile.audio_ring = ini_as_bool(ini_get(audio, "ring"));
+    g_profile.audio_rate_control = ini_as_bool(ini_get(audio, "rate_control"));
+    g_profile.audio_pacing = ini_as_bool(ini_get(audio, "pacing"));
+    g_profile.audio_latency = Profile_ReadNum(audio, "latency", DEFAULT_AUDIO_LATENCY);
+    if (g_profile.audio_latency <= 0) return SDL_SetError("field \"audio.latency\" must be positive in profile \"%s\"", path);
+
+    initable_t *scan = ini_get_table(&g_profile.ini, "scan");
+    g_profile.scan_width = Profile_ReadNum(scan, "width", DEFAULT_SCAN_WIDTH);
+    if (g_profile.scan_width != 8 && g_profile.scan_width != 16 && g_profile.scan_width != 32) return SDL_SetError("field \"scan.width\" can only be 8, 16 or 32 in profile \"%s\"", path);
+    g_profile.scan_value = ini_as_uint(ini_get(scan, "value"));
+
+    initable_t *trace = ini_get_table(&g_profile.ini, "trace");
+    ini_to_str(ini_get(trace, "path"), g_profile.trace, sizeof(g_profile.trace), false);
+
+    Profile_ReadPairs(ini_get_table(&g_profile.ini, "bindings"), &g_profile.bindings);
+    Profile_ReadPairs(ini_get_table(&g_profile.ini, "vars"), &g_profile.vars);
 
     SDL_Log("loaded profile \"%s\"", path);
     return SDL_ClearError();
@@ -116,12 +198,60 @@ const char *Profile_GetAutosavePath(void)
     return g_profile.autosave;
 }
 
+const char *Profile_GetTracePath(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.trace;
+}
+
 bool Profile_IsFullscreen(void)
 {
     SDL_assert_release(ini_is_valid(&g_profile.ini));
     return g_profile.fullscreen;
 }
 
+bool Profile_IsThreaded(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.threaded;
+}
+
+gl_vsync_t Profile_GetVsync(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.vsync;
+}
+
+int Profile_GetHardSyncFrames(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.hard_sync_frames;
+}
+
+bool Profile_IsAudioRingEnabled(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.audio_ring;
+}
+
+bool Profile_IsAudioRateControlEnabled(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.audio_rate_control;
+}
+
+bool Profile_IsAudioPacingEnabled(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.audio_pacing;
+}
+
+float Profile_GetAudioLatency(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.audio_latency;
+}
+
 float Profile_GetMouseSensitivityX(void)
 {
     SDL_assert_release(ini_is_valid(&g_profile.ini));
@@ -134,10 +264,22 @@ float Profile_GetMouseSensitivityY(void)
     return g_profile.mouse_sensitivity_y;
 }
 
-core_mouse_hack_t Profile_GetMouseHackProfile(void)
+float Profile_GetMouseAcceleration(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.mouse_acceleration;
+}
+
+float Profile_GetMouseAccelerationCap(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.mouse_acceleration_cap;
+}
+
+const char *Profile_GetMouseHack(void)
 {
     SDL_assert_release(ini_is_valid(&g_profile.ini));
-    return g_profile.mouse_hack_profile;
+    return g_profile.mouse_hack;
 }
 
 float Profile_GetAutosavePeriod(void)
@@ -146,6 +288,80 @@ float Profile_GetAutosavePeriod(void)
     return g_profile.autosave_period;
 }
 
+float Profile_GetPacerSleepMargin(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.pacer_sleep_margin;
+}
+
+bool Profile_IsFrameDelayEnabled(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.frame_delay;
+}
+
+unsigned int Profile_GetRunAheadFrames(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.run_ahead_frames;
+}
+
+unsigned int Profile_GetFastForwardRatio(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.fast_forward_ratio;
+}
+
+bool Profile_IsFastForwardToggle(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.fast_forward_toggle;
+}
+
+unsigned int Profile_GetRewindBudget(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.rewind_budget;
+}
+
+unsigned int Profile_GetRewindInterval(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.rewind_interval;
+}
+
+unsigned int Profile_GetScanWidth(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.scan_width;
+}
+
+unsigned int Profile_GetScanValue(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.scan_value;
+}
+
+unsigned int Profile_GetBindingCount(void)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    return g_profile.bindings.count;
+}
+
+const char *Profile_GetBindingKey(unsigned int idx)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    SDL_assert_release(idx < g_profile.bindings.count);
+    return g_profile.bindings.names[idx];
+}
+
+const char *Profile_GetBindingAction(unsigned int idx)
+{
+    SDL_assert_release(ini_is_valid(&g_profile.ini));
+    SDL_assert_release(idx < g_profile.bindings.count);
+    return g_profile.bindings.values[idx];
+}
+
 unsigned int Profile_GetVarCount(void)
 {
     SDL_assert_release(ini_is_valid(&g_profile.ini));
@@ -181,3 +397,38 @@ const char *Profile_GetVarValueByName(const char *name)
     unsigned int i = Profile_GetVarIdx(name);
     return (i < g_profile.vars.count) ? (g_profile.vars.values[i]) : (0);
 }
+
+double Profile_ReadNum(initable_t *table, const char *key, double fallback)
+{
+    inivalue_t *v = ini_get(table, key);
+    return (v) ? (ini_as_num(v)) : (fallback);
+}
+
+void Profile_ReadPairs(initable_t *table, profile_pairs_t *pairs)
+{
+    if (!table)
+        return;
+
+    pairs->count = ivec_len(table->values);
+    pairs->names = SDL_calloc(pairs->count, sizeof(pairs->names[0]));
+    pairs->values = SDL_calloc(pairs->count, sizeof(pairs->values[0]));
+    for (unsigned int i = 0; i < pairs->count; i++)
+    {
+        // Values keep the spaces in front of an inline comment.
+        inivalue_t v = table->values[i];
+        while (v.value.len && SDL_isspace(v.value.buf[v.value.len - 1])) v.value.len--;
+        pairs->names[i] = SDL_strndup(v.key.buf, v.key.len);
+        pairs->values[i] = SDL_strndup(v.value.buf, v.value.len);
+    }
+}
+
+void Profile_FreePairs(profile_pairs_t *pairs)
+{
+    for (unsigned int i = 0; i < pairs->count; i++)
+    {
+        SDL_free(pairs->names[i]);
+        SDL_free(pairs->values[i]);
+    }
+    SDL_free(pairs->names);
+    SDL_free(pairs->values);
+}
@@ -3,7 +3,7 @@
 #include <SDL3/SDL_stdinc.h>
 #include <SDL3/SDL_keycode.h>
 
-#include "core.h"
+#include "gl.h"
 
 bool Profile_Load(const char *path);
 
@@ -12,11 +12,34 @@ const char       *Profile_GetGamePath(void);
 const char       *Profile_GetSavePath(void);
 const char       *Profile_GetSystemPath(void);
 const char       *Profile_GetAutosavePath(void);
+const char       *Profile_GetTracePath(void);
 bool              Profile_IsFullscreen(void);
+bool              Profile_IsThreaded(void);
+gl_vsync_t        Profile_GetVsync(void);
+int               Profile_GetHardSyncFrames(void);
+bool              Profile_IsAudioRingEnabled(void);
+bool              Profile_IsAudioRateControlEnabled(void);
+bool              Profile_IsAudioPacingEnabled(void);
+float             Profile_GetAudioLatency(void);
 float             Profile_GetMouseSensitivityX(void);
 float             Profile_GetMouseSensitivityY(void);
-core_mouse_hack_t Profile_GetMouseHackProfile(void);
+float             Profile_GetMouseAcceleration(void);
+float             Profile_GetMouseAccelerationCap(void);
+const char       *Profile_GetMouseHack(void);
 float             Profile_GetAutosavePeriod(void);
+float             Profile_GetPacerSleepMargin(void);
+bool              Profile_IsFrameDelayEnabled(void);
+unsigned int      Profile_GetRunAheadFrames(void);
+unsigned int      Profile_GetFastForwardRatio(void);
+bool              Profile_IsFastForwardToggle(void);
+unsigned int      Profile_GetRewindBudget(void);
+unsigned int      Profile_GetRewindInterval(void);
+unsigned int      Profile_GetScanWidth(void);
+unsigned int      Profile_GetScanValue(void);
+
+unsigned int Profile_GetBindingCount(void);
+const char  *Profile_GetBindingKey(unsigned int idx);
+const char  *Profile_GetBindingAction(unsigned int idx);
 
 unsigned int Profile_GetVarCount(void);
 const char  *Profile_GetVarName(unsigned int idx);
@@ -0,0 +1,202 @@
+#include "rewind.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_timer.h>
+
+#include "rle.h"
+#include "core.h"
+#include "profile.h"
+
+#define REWIND_MAX_ENTRIES 65536
+
+typedef struct rewind_entry_t rewind_entry_t;
+struct rewind_entry_t {
+    size_t offset;
+    size_t size;
+};
+
+// History is kept as the most recent full state plus a ring of compressed XOR deltas, each of
+// which turns a state into the one captured before it. Stepping back restores the full state
+// first and after that decodes the newest delta into it in place, capturing encodes the new
+// state against it.
+static struct {
+    bool enabled;
+    unsigned int interval;
+    unsigned int frame;
+    size_t state_size;
+    Uint8 *current;
+    Uint8 *scratch;
+    Uint8 *delta;
+    size_t delta_capacity;
+    bool has_current;
+    bool current_restored;
+    bool restore_failed;
+    struct {
+        Uint8 *data;
+        size_t capacity;
+        size_t head;
+        rewind_entry_t *entries;
+        unsigned int first;
+        unsigned int count;
+    } ring;
+    struct {
+        Uint64 captures;
+        Uint64 total_ns;
+        Uint64 max_ns;
+        Uint64 delta_bytes;
+    } stats;
+} g_rewind;
+
+static void Rewind_Push(const Uint8 *delta, size_t size);
+
+bool Rewind_Init(void)
+{
+    Rewind_Free();
+
+    size_t budget = (size_t)Profile_GetRewindBudget() * 1024 * 1024;
+    if (!budget)
+        return true;
+
+    g_rewind.interval = Profile_GetRewindInterval();
+    g_rewind.state_size = Core_GetStateSize();
+    g_rewind.delta_capacity = Rle_GetMaxEncodedSize(g_rewind.state_size);
+
+    size_t fixed = g_rewind.state_size * 2 + g_rewind.delta_capacity + sizeof(rewind_entry_t) * REWIND_MAX_ENTRIES;
+    if (!g_rewind.state_size || budget < fixed + g_rewind.delta_capacity)
+        return SDL_SetError("rewind budget of %zu MB is too small for %zu KB savestates", budget / 1024 / 1024, g_rewind.state_size / 1024);
+
+    g_rewind.current = SDL_malloc(g_rewind.state_size);
+    g_rewind.scratch = SDL_malloc(g_rewind.state_size);
+    g_rewind.delta = SDL_malloc(g_rewind.delta_capacity);
+    g_rewind.ring.capacity = budget - fixed;
+    g_rewind.ring.data = SDL_malloc(g_rewind.ring.capacity);
+    g_rewind.ring.entries = SDL_malloc(sizeof(rewind_entry_t) * REWIND_MAX_ENTRIES);
+    if (!g_rewind.current || !g_rewind.scratch || !g_rewind.delta || !g_rewind.ring.data || !g_rewind.ring.entries)
+    {
+        Rewind_Free();
+        return SDL_SetError("failed to allocate %zu MB for rewind", budget / 1024 / 1024);
+    }
+
+    g_rewind.enabled = true;
+    SDL_Log("rewind enabled (%zu MB, state every %u frames)", budget / 1024 / 1024, g_rewind.interval);
+    return true;
+}
+
+void Rewind_Free(void)
+{
+    if (g_rewind.stats.captures)
+    {
+        SDL_Log(
+            "rewind captured %llu states, %.2f ms per capture (max %.2f), %.1f KB per delta, %u states held",
+            (unsigned long long)g_rewind.stats.captures,
+            g_rewind.stats.total_ns / 1e6 / g_rewind.stats.captures,
+            g_rewind.stats.max_ns / 1e6,
+            g_rewind.stats.delta_bytes / 1024.0 / g_rewind.stats.captures,
+            g_rewind.ring.count
+        );
+    }
+
+    SDL_free(g_rewind.current);
+    SDL_free(g_rewind.scratch);
+    SDL_free(g_rewind.delta);
+    SDL_free(g_rewind.ring.data);
+    SDL_free(g_rewind.ring.entries);
+    SDL_memset(&g_rewind, 0, sizeof(g_rewind));
+}
+
+void Rewind_Capture(void)
+{
+    if (!g_rewind.enabled || ++g_rewind.frame < g_rewind.interval)
+        return;
+
+    g_rewind.frame = 0;
+
+    Uint64 t0 = SDL_GetTicksNS();
+
+    if (Core_GetStateSize() != g_rewind.state_size || !Core_SerializeState(g_rewind.scratch, g_rewind.state_size))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to capture rewind state, disabling rewind");
+        Rewind_Free();
+        return;
+    }
+
+    if (g_rewind.has_current)
+    {
+        size_t size = Rle_Encode(g_rewind.scratch, g_rewind.current, g_rewind.state_size, g_rewind.delta, g_rewind.delta_capacity);
+        SDL_assert_release(size);
+        Rewind_Push(g_rewind.delta, size);
+        g_rewind.stats.delta_bytes += size;
+    }
+
+    Uint8 *t = g_rewind.current;
+    g_rewind.current = g_rewind.scratch;
+    g_rewind.scratch = t;
+    g_rewind.has_current = true;
+    g_rewind.current_restored = false;
+
+    Uint64 ns = SDL_GetTicksNS() - t0;
+    g_rewind.stats.captures++;
+    g_rewind.stats.total_ns += ns;
+    g_rewind.stats.max_ns = SDL_max(g_rewind.stats.max_ns, ns);
+}
+
+bool Rewind_StepBack(void)
+{
+    if (!g_rewind.enabled || !g_rewind.has_current)
+        return false;
+
+    // Once the oldest state has been restored there is nothing left to step back to.
+    if (g_rewind.current_restored && !g_rewind.ring.count)
+        return false;
+
+    if (g_rewind.current_restored)
+    {
+        rewind_entry_t e = g_rewind.ring.entries[(g_rewind.ring.first + g_rewind.ring.count - 1) % REWIND_MAX_ENTRIES];
+        bool ok = Rle_Decode(g_rewind.ring.data + e.offset, e.size, g_rewind.current, g_rewind.state_size, true);
+        SDL_assert_release(ok);
+        g_rewind.ring.count--;
+        g_rewind.ring.head = e.offset;
+    }
+
+    g_rewind.frame = 0;
+    g_rewind.current_restored = true;
+    if (!Core_UnserializeState(g_rewind.current, g_rewind.state_size))
+    {
+        if (!g_rewind.restore_failed)
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to restore rewind state");
+        g_rewind.restore_failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool Rewind_IsEnabled(void)
+{
+    return g_rewind.enabled;
+}
+
+void Rewind_Push(const Uint8 *delta, size_t size)
+{
+    SDL_assert_release(size <= g_rewind.ring.capacity);
+
+    size_t pos = g_rewind.ring.head;
+    bool wrapped = pos + size > g_rewind.ring.capacity;
+    if (wrapped) pos = 0;
+
+    // The oldest entries are always the ones right after the head, so making room means
+    // dropping them until the new one fits. Entries past the head are dropped on wrap-around.
+    while (g_rewind.ring.count)
+    {
+        rewind_entry_t *e = &g_rewind.ring.entries[g_rewind.ring.first];
+        bool overlaps = e->offset < pos + size && pos < e->offset + e->size;
+        bool skipped = wrapped && e->offset >= g_rewind.ring.head;
+        if (!overlaps && !skipped && g_rewind.ring.count < REWIND_MAX_ENTRIES) break;
+        g_rewind.ring.first = (g_rewind.ring.first + 1) % REWIND_MAX_ENTRIES;
+        g_rewind.ring.count--;
+    }
+
+    SDL_memcpy(g_rewind.ring.data + pos, delta, size);
+    g_rewind.ring.entries[(g_rewind.ring.first + g_rewind.ring.count) % REWIND_MAX_ENTRIES] = (rewind_entry_t){ pos, size };
+    g_rewind.ring.count++;
+    g_rewind.ring.head = pos + size;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+bool Rewind_Init(void);
+void Rewind_Free(void);
+
+void Rewind_Capture(void);
+bool Rewind_StepBack(void);
+bool Rewind_IsEnabled(void);
@@ -0,0 +1,50 @@
+#include "ring.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_atomic.h>
+
+void Ring_Init(ring_t *ring, void *data, Uint32 elem_size, Uint32 capacity)
+{
+    SDL_assert_release(ring && data && elem_size);
+    SDL_assert_release(capacity && !(capacity & (capacity - 1)));
+    ring->data = data;
+    ring->elem_size = elem_size;
+    ring->capacity = capacity;
+    SDL_SetAtomicU32(&ring->head, 0);
+    SDL_SetAtomicU32(&ring->tail, 0);
+}
+
+Uint32 Ring_Write(ring_t *ring, const void *elems, Uint32 count)
+{
+    Uint32 head = SDL_GetAtomicU32(&ring->head);
+    Uint32 tail = SDL_GetAtomicU32(&ring->tail);
+    count = SDL_min(count, ring->capacity - (head - tail));
+
+    Uint32 start = head & (ring->capacity - 1);
+    Uint32 first = SDL_min(count, ring->capacity - start);
+    SDL_memcpy(ring->data + start * ring->elem_size, elems, first * ring->elem_size);
+    SDL_memcpy(ring->data, (const Uint8*)elems + first * ring->elem_size, (count - first) * ring->elem_size);
+
+    SDL_SetAtomicU32(&ring->head, head + count);
+    return count;
+}
+
+Uint32 Ring_Read(ring_t *ring, void *elems, Uint32 count)
+{
+    Uint32 tail = SDL_GetAtomicU32(&ring->tail);
+    Uint32 head = SDL_GetAtomicU32(&ring->head);
+    count = SDL_min(count, head - tail);
+
+    Uint32 start = tail & (ring->capacity - 1);
+    Uint32 first = SDL_min(count, ring->capacity - start);
+    SDL_memcpy(elems, ring->data + start * ring->elem_size, first * ring->elem_size);
+    SDL_memcpy((Uint8*)elems + first * ring->elem_size, ring->data, (count - first) * ring->elem_size);
+
+    SDL_SetAtomicU32(&ring->tail, tail + count);
+    return count;
+}
+
+Uint32 Ring_GetCount(ring_t *ring)
+{
+    return SDL_GetAtomicU32(&ring->head) - SDL_GetAtomicU32(&ring->tail);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_atomic.h>
+
+// Lock-free single-producer single-consumer queue of fixed-size elements.
+typedef struct ring_t ring_t;
+struct ring_t {
+    Uint8 *data;
+    Uint32 elem_size;
+    Uint32 capacity;
+    SDL_AtomicU32 head;
+    SDL_AtomicU32 tail;
+};
+
+void   Ring_Init(ring_t *ring, void *data, Uint32 elem_size, Uint32 capacity);
+Uint32 Ring_Write(ring_t *ring, const void *elems, Uint32 count);
+Uint32 Ring_Read(ring_t *ring, void *elems, Uint32 count);
+Uint32 Ring_GetCount(ring_t *ring);
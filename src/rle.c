@@ -0,0 +1,115 @@
+#include "rle.h"
+
+#include <SDL3/SDL.h>
+
+static Uint64  Rle_LoadWord(const Uint8 *data, const Uint8 *reference, size_t idx);
+static Uint8  *Rle_PutCount(Uint8 *p, Uint8 *end, size_t count);
+static bool    Rle_GetCount(const Uint8 **p, const Uint8 *end, size_t *count);
+
+size_t Rle_GetMaxEncodedSize(size_t size)
+{
+    // Worst case is a single literal token covering the whole input.
+    return size + 2 * 10;
+}
+
+size_t Rle_Encode(const void *data, const void *reference, size_t size, void *out, size_t capacity)
+{
+    const Uint8 *src = data;
+    const Uint8 *ref = reference;
+    Uint8 *p = out;
+    Uint8 *end = p + capacity;
+    size_t words = size / 8;
+
+    for (size_t i = 0; i < words;)
+    {
+        size_t zeros = i;
+        while (i < words && !Rle_LoadWord(src, ref, i)) i++;
+        zeros = i - zeros;
+
+        size_t literals = i;
+        while (i < words && Rle_LoadWord(src, ref, i)) i++;
+        literals = i - literals;
+
+        if (!(p = Rle_PutCount(p, end, zeros))) return 0;
+        if (!(p = Rle_PutCount(p, end, literals))) return 0;
+        if (literals * 8 > (size_t)(end - p)) return 0;
+
+        for (size_t j = i - literals; j < i; j++, p += 8)
+        {
+            Uint64 w = Rle_LoadWord(src, ref, j);
+            SDL_memcpy(p, &w, 8);
+        }
+    }
+
+    size_t tail = size % 8;
+    if (tail > (size_t)(end - p)) return 0;
+    for (size_t j = size - tail; j < size; j++)
+        *p++ = (ref) ? (src[j] ^ ref[j]) : (src[j]);
+
+    return p - (Uint8*)out;
+}
+
+bool Rle_Decode(const void *encoded, size_t encoded_size, void *out, size_t size, bool xor)
+{
+    const Uint8 *p = encoded;
+    const Uint8 *end = p + encoded_size;
+    Uint8 *dst = out;
+    size_t words = size / 8;
+
+    for (size_t i = 0; i < words;)
+    {
+        size_t zeros, literals;
+        if (!Rle_GetCount(&p, end, &zeros) || !Rle_GetCount(&p, end, &literals)) return false;
+        if (zeros + literals > words - i || literals * 8 > (size_t)(end - p)) return false;
+
+        if (!xor) SDL_memset(dst + i * 8, 0, zeros * 8);
+        i += zeros;
+
+        for (size_t j = 0; j < literals; j++, i++, p += 8)
+        {
+            Uint64 w, d;
+            SDL_memcpy(&w, p, 8);
+            SDL_memcpy(&d, dst + i * 8, 8);
+            w = (xor) ? (w ^ d) : (w);
+            SDL_memcpy(dst + i * 8, &w, 8);
+        }
+    }
+
+    size_t tail = size % 8;
+    if (tail != (size_t)(end - p)) return false;
+    for (size_t j = size - tail; j < size; j++)
+        dst[j] = (xor) ? (dst[j] ^ *p++) : (*p++);
+
+    return true;
+}
+
+Uint64 Rle_LoadWord(const Uint8 *data, const Uint8 *reference, size_t idx)
+{
+    Uint64 w, r = 0;
+    SDL_memcpy(&w, data + idx * 8, 8);
+    if (reference) SDL_memcpy(&r, reference + idx * 8, 8);
+    return w ^ r;
+}
+
+Uint8 *Rle_PutCount(Uint8 *p, Uint8 *end, size_t count)
+{
+    do
+    {
+        if (p >= end) return 0;
+        *p++ = (count & 0x7F) | ((count > 0x7F) ? (0x80) : (0));
+        count >>= 7;
+    } while (count);
+    return p;
+}
+
+bool Rle_GetCount(const Uint8 **p, const Uint8 *end, size_t *count)
+{
+    *count = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7)
+    {
+        Uint8 b = *(*p)++;
+        *count |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
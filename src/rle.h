@@ -0,0 +1,12 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+// Zero-run encoding over 8-byte words. The stream is a sequence of (zero word count, literal
+// word count, literal words) tokens with LEB128 counts, followed by the trailing size % 8 bytes.
+// Encoding can XOR the input with a reference buffer on the fly which turns two similar
+// savestates into a mostly zero delta, decoding can XOR the result into the destination.
+
+size_t Rle_GetMaxEncodedSize(size_t size);
+size_t Rle_Encode(const void *data, const void *reference, size_t size, void *out, size_t capacity);
+bool   Rle_Decode(const void *encoded, size_t encoded_size, void *out, size_t size, bool xor);
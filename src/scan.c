@@ -0,0 +1,193 @@
+#include "scan.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_intrin.h>
+#include <SDL3/SDL_timer.h>
+
+// Candidates are tracked in blocks of 16 values, one bit each, so a block is a single compare
+// and movemask per 16 bytes of RAM. Blocks without candidates are skipped without touching
+// RAM, which makes later passes a lot cheaper than the first one.
+#define SCAN_BLOCK_LANES 16
+#define SCAN_LIST_MAX 16
+
+static const char *g_scan_filter_names[] = {
+    [SCAN_FILTER_CHANGED]   = "changed",
+    [SCAN_FILTER_UNCHANGED] = "unchanged",
+    [SCAN_FILTER_INCREASED] = "increased",
+    [SCAN_FILTER_DECREASED] = "decreased",
+    [SCAN_FILTER_EQUAL]     = "equal",
+};
+
+static struct {
+    const Uint8 *ram;
+    Uint8 *snapshot;
+    Uint16 *bits;
+    size_t blocks;
+    unsigned int width;
+} g_scan;
+
+static Uint16 Scan_CompareBlock(const Uint8 *cur, const Uint8 *old, scan_filter_t filter, Uint32 value);
+static Uint32 Scan_Load(const Uint8 *p, unsigned int width);
+static void   Scan_List(void);
+
+bool Scan_Start(const Uint8 *ram, size_t size, unsigned int width)
+{
+    Scan_Free();
+    SDL_assert_release(ram);
+
+    if (width != 1 && width != 2 && width != 4)
+        return SDL_SetError("scan width must be 1, 2 or 4 bytes, not %u", width);
+
+    g_scan.ram = ram;
+    g_scan.width = width;
+    g_scan.blocks = size / (SCAN_BLOCK_LANES * width);
+    if (!(g_scan.snapshot = SDL_malloc(size)) || !(g_scan.bits = SDL_malloc(g_scan.blocks * sizeof(Uint16))))
+    {
+        Scan_Free();
+        return SDL_SetError("failed to allocate %zu bytes for RAM scan", size);
+    }
+
+    SDL_memcpy(g_scan.snapshot, ram, size);
+    SDL_memset(g_scan.bits, 0xFF, g_scan.blocks * sizeof(Uint16));
+
+    SDL_Log("scan: started with %zu %u-bit candidates", Scan_GetCount(), width * 8);
+    return true;
+}
+
+bool Scan_Filter(scan_filter_t filter, Uint32 value)
+{
+    if (!g_scan.bits)
+        return SDL_SetError("no scan in progress");
+
+    Uint64 t0 = SDL_GetTicksNS();
+
+    size_t block_size = SCAN_BLOCK_LANES * g_scan.width;
+    for (size_t i = 0; i < g_scan.blocks; i++)
+        if (g_scan.bits[i])
+            g_scan.bits[i] &= Scan_CompareBlock(g_scan.ram + i * block_size, g_scan.snapshot + i * block_size, filter, value);
+
+    Uint64 t1 = SDL_GetTicksNS();
+
+    if (filter == SCAN_FILTER_EQUAL)
+        SDL_Log("scan: %zu candidates equal to %u (%.3f ms)", Scan_GetCount(), value, (t1 - t0) / 1e6);
+    else
+        SDL_Log("scan: %zu candidates %s (%.3f ms)", Scan_GetCount(), g_scan_filter_names[filter], (t1 - t0) / 1e6);
+
+    Scan_List();
+    SDL_memcpy(g_scan.snapshot, g_scan.ram, g_scan.blocks * block_size);
+    return true;
+}
+
+size_t Scan_GetCount(void)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < g_scan.blocks; i++)
+        for (Uint16 b = g_scan.bits[i]; b; b &= b - 1)
+            count++;
+    return count;
+}
+
+void Scan_Free(void)
+{
+    SDL_free(g_scan.snapshot);
+    SDL_free(g_scan.bits);
+    SDL_memset(&g_scan, 0, sizeof(g_scan));
+}
+
+void Scan_List(void)
+{
+    if (Scan_GetCount() > SCAN_LIST_MAX)
+        return;
+
+    for (size_t i = 0; i < g_scan.blocks; i++)
+    {
+        for (unsigned int lane = 0; lane < SCAN_BLOCK_LANES; lane++)
+        {
+            if (!(g_scan.bits[i] & (1u << lane)))
+                continue;
+
+            size_t offset = (i * SCAN_BLOCK_LANES + lane) * g_scan.width;
+            SDL_Log("scan:   0x%06zX = %u (was %u)", offset, Scan_Load(g_scan.ram + offset, g_scan.width), Scan_Load(g_scan.snapshot + offset, g_scan.width));
+        }
+    }
+}
+
+Uint16 Scan_CompareBlock(const Uint8 *cur, const Uint8 *old, scan_filter_t filter, Uint32 value)
+{
+#ifdef SDL_SSE2_INTRINSICS
+    // SSE2 only compares signed integers so both sides get their sign bit flipped for the
+    // ordered filters. Lane masks of wider values are narrowed with saturating packs until
+    // there is one byte per value left for the movemask.
+    __m128i m[4];
+    for (unsigned int v = 0; v < g_scan.width; v++)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(cur + v * 16));
+        __m128i b = _mm_loadu_si128((const __m128i*)(old + v * 16));
+        __m128i sign, x;
+        switch (g_scan.width)
+        {
+        case 1:  sign = _mm_set1_epi8((char)0x80); x = _mm_set1_epi8((char)value); break;
+        case 2:  sign = _mm_set1_epi16((short)0x8000); x = _mm_set1_epi16((short)value); break;
+        default: sign = _mm_set1_epi32((int)0x80000000); x = _mm_set1_epi32((int)value); break;
+        }
+
+        if (filter == SCAN_FILTER_EQUAL)
+            b = x;
+        if (filter == SCAN_FILTER_INCREASED || filter == SCAN_FILTER_DECREASED)
+        {
+            a = _mm_xor_si128(a, sign);
+            b = _mm_xor_si128(b, sign);
+        }
+        if (filter == SCAN_FILTER_DECREASED)
+        {
+            __m128i t = a; a = b; b = t;
+        }
+
+        bool ordered = filter == SCAN_FILTER_INCREASED || filter == SCAN_FILTER_DECREASED;
+        switch (g_scan.width)
+        {
+        case 1:  m[v] = (ordered) ? (_mm_cmpgt_epi8(a, b)) : (_mm_cmpeq_epi8(a, b)); break;
+        case 2:  m[v] = (ordered) ? (_mm_cmpgt_epi16(a, b)) : (_mm_cmpeq_epi16(a, b)); break;
+        default: m[v] = (ordered) ? (_mm_cmpgt_epi32(a, b)) : (_mm_cmpeq_epi32(a, b)); break;
+        }
+    }
+
+    int mask;
+    switch (g_scan.width)
+    {
+    case 1:  mask = _mm_movemask_epi8(m[0]); break;
+    case 2:  mask = _mm_movemask_epi8(_mm_packs_epi16(m[0], m[1])); break;
+    default: mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]))); break;
+    }
+    return (filter == SCAN_FILTER_CHANGED) ? (~mask) : (mask);
+#else
+    Uint16 mask = 0;
+    for (unsigned int lane = 0; lane < SCAN_BLOCK_LANES; lane++)
+    {
+        Uint32 a = Scan_Load(cur + lane * g_scan.width, g_scan.width);
+        Uint32 b = Scan_Load(old + lane * g_scan.width, g_scan.width);
+        bool hit;
+        switch (filter)
+        {
+        case SCAN_FILTER_CHANGED:   hit = a != b; break;
+        case SCAN_FILTER_UNCHANGED: hit = a == b; break;
+        case SCAN_FILTER_INCREASED: hit = a > b; break;
+        case SCAN_FILTER_DECREASED: hit = a < b; break;
+        default:                    hit = a == (value & (0xFFFFFFFFu >> (32 - g_scan.width * 8))); break;
+        }
+        mask |= (Uint16)hit << lane;
+    }
+    return mask;
+#endif
+}
+
+Uint32 Scan_Load(const Uint8 *p, unsigned int width)
+{
+    Uint8 v8; Uint16 v16; Uint32 v32;
+    switch (width)
+    {
+    case 1:  SDL_memcpy(&v8, p, 1); return v8;
+    case 2:  SDL_memcpy(&v16, p, 2); return v16;
+    default: SDL_memcpy(&v32, p, 4); return v32;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+// Narrows down RAM addresses by how their values change between snapshots, one candidate per
+// aligned value of the chosen width (1, 2 or 4 bytes).
+
+typedef enum scan_filter_t scan_filter_t;
+enum scan_filter_t {
+    SCAN_FILTER_CHANGED,
+    SCAN_FILTER_UNCHANGED,
+    SCAN_FILTER_INCREASED,
+    SCAN_FILTER_DECREASED,
+    SCAN_FILTER_EQUAL,
+};
+
+bool   Scan_Start(const Uint8 *ram, size_t size, unsigned int width);
+bool   Scan_Filter(scan_filter_t filter, Uint32 value);
+size_t Scan_GetCount(void);
+void   Scan_Free(void);
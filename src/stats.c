@@ -0,0 +1,115 @@
+#include "stats.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_bits.h>
+
+// Log-linear buckets: values below 2^STATS_SUB_BITS ns get a bucket each, every power of two
+// above that is split into 2^STATS_SUB_BITS equal buckets which bounds the error to ~0.4%
+// (about 65 us around 16 ms). The last bucket collects everything above ~137 s.
+#define STATS_SUB_BITS 7
+#define STATS_SUB_COUNT (1 << STATS_SUB_BITS)
+#define STATS_OCTAVES 31
+#define STATS_BUCKET_COUNT (STATS_SUB_COUNT * STATS_OCTAVES)
+
+static const char *g_stats_stage_names[STATS_STAGE_COUNT] = {
+    [STATS_STAGE_FRAME]   = "frame",
+    [STATS_STAGE_RUN]     = "retro_run",
+    [STATS_STAGE_AUDIO]   = "audio flush",
+    [STATS_STAGE_PRESENT] = "present",
+    [STATS_STAGE_SWAP]    = "swap",
+    [STATS_STAGE_IDLE]    = "idle",
+    [STATS_STAGE_LATENCY] = "present latency",
+    [STATS_STAGE_INPUT]   = "input delay",
+};
+
+// Every stage is written by a single thread, readers on other threads may see slightly stale
+// counts which is fine for reporting.
+static struct {
+    struct {
+        Uint64 count;
+        Uint64 total;
+        Uint64 max;
+        Uint32 buckets[STATS_BUCKET_COUNT];
+    } stages[STATS_STAGE_COUNT];
+} g_stats;
+
+static unsigned int Stats_GetBucket(Uint64 ns);
+static Uint64       Stats_GetBucketValue(unsigned int bucket);
+
+void Stats_Record(stats_stage_t stage, Uint64 ns)
+{
+    SDL_assert_release(stage < STATS_STAGE_COUNT);
+    g_stats.stages[stage].count++;
+    g_stats.stages[stage].total += ns;
+    g_stats.stages[stage].max = SDL_max(g_stats.stages[stage].max, ns);
+    g_stats.stages[stage].buckets[Stats_GetBucket(ns)]++;
+}
+
+Uint64 Stats_GetCount(stats_stage_t stage)
+{
+    SDL_assert_release(stage < STATS_STAGE_COUNT);
+    return g_stats.stages[stage].count;
+}
+
+Uint64 Stats_GetPercentile(stats_stage_t stage, double p)
+{
+    SDL_assert_release(stage < STATS_STAGE_COUNT);
+
+    Uint64 count = g_stats.stages[stage].count;
+    if (!count)
+        return 0;
+
+    Uint64 rank = SDL_clamp((Uint64)(p / 100.0 * count + 0.5), 1, count);
+    Uint64 seen = 0;
+    for (unsigned int i = 0; i < STATS_BUCKET_COUNT; i++)
+    {
+        seen += g_stats.stages[stage].buckets[i];
+        if (seen >= rank)
+            return SDL_min(Stats_GetBucketValue(i), g_stats.stages[stage].max);
+    }
+    return g_stats.stages[stage].max;
+}
+
+void Stats_Log(void)
+{
+    SDL_Log("%-12s %10s %9s %9s %9s %9s %9s %9s", "stage (ms)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int s = 0; s < STATS_STAGE_COUNT; s++)
+    {
+        Uint64 n = g_stats.stages[s].count;
+        if (!n) continue;
+
+        SDL_Log(
+            "%-12s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f",
+            g_stats_stage_names[s],
+            (unsigned long long)n,
+            g_stats.stages[s].total / 1e6 / n,
+            Stats_GetPercentile(s, 50) / 1e6,
+            Stats_GetPercentile(s, 90) / 1e6,
+            Stats_GetPercentile(s, 99) / 1e6,
+            Stats_GetPercentile(s, 99.9) / 1e6,
+            g_stats.stages[s].max / 1e6
+        );
+    }
+}
+
+unsigned int Stats_GetBucket(Uint64 ns)
+{
+    if (ns < STATS_SUB_COUNT)
+        return ns;
+
+    int msb = (ns >> 32) ? (32 + SDL_MostSignificantBitIndex32(ns >> 32)) : (SDL_MostSignificantBitIndex32(ns));
+    int shift = msb - STATS_SUB_BITS;
+    unsigned int bucket = (shift + 1) * STATS_SUB_COUNT + ((ns >> shift) - STATS_SUB_COUNT);
+    return SDL_min(bucket, STATS_BUCKET_COUNT - 1);
+}
+
+Uint64 Stats_GetBucketValue(unsigned int bucket)
+{
+    // Midpoint of the bucket's range.
+    if (bucket < STATS_SUB_COUNT)
+        return bucket;
+
+    int shift = bucket / STATS_SUB_COUNT - 1;
+    Uint64 mantissa = bucket % STATS_SUB_COUNT + STATS_SUB_COUNT;
+    return (mantissa << shift) + ((1ull << shift) >> 1);
+}
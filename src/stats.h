@@ -0,0 +1,21 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+typedef enum stats_stage_t stats_stage_t;
+enum stats_stage_t {
+    STATS_STAGE_FRAME,
+    STATS_STAGE_RUN,
+    STATS_STAGE_AUDIO,
+    STATS_STAGE_PRESENT,
+    STATS_STAGE_SWAP,
+    STATS_STAGE_IDLE,
+    STATS_STAGE_LATENCY,
+    STATS_STAGE_INPUT,
+    STATS_STAGE_COUNT,
+};
+
+void   Stats_Record(stats_stage_t stage, Uint64 ns);
+Uint64 Stats_GetCount(stats_stage_t stage);
+Uint64 Stats_GetPercentile(stats_stage_t stage, double p);
+void   Stats_Log(void);
@@ -0,0 +1,185 @@
+#include "trace.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_thread.h>
+#include <SDL3/SDL_timer.h>
+#include <SDL3/SDL_iostream.h>
+
+#include "profile.h"
+
+#define TRACE_RING_SIZE 65536 // events per thread, must be a power of two
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+#define TRACE_MAX_THREADS 8
+
+typedef struct trace_event_t trace_event_t;
+struct trace_event_t {
+    const char *name;
+    Uint64 time;
+    Uint32 arg;
+    char phase;
+    bool has_arg;
+};
+
+// Every thread records into its own ring that only it writes to and that overwrites the oldest
+// events once full, so recording never blocks or allocates after the thread's first event.
+typedef struct trace_thread_t trace_thread_t;
+struct trace_thread_t {
+    const char *name;
+    SDL_AtomicU32 head;
+    trace_event_t events[TRACE_RING_SIZE];
+};
+
+static struct {
+    bool enabled;
+    SDL_TLSID tls;
+    SDL_AtomicInt thread_count;
+    void *threads[TRACE_MAX_THREADS];
+    trace_event_t *copy;
+} g_trace;
+
+static trace_thread_t *Trace_GetThread(void);
+static void            Trace_Record(const char *name, char phase, Uint32 arg, bool has_arg);
+
+bool Trace_Init(void)
+{
+    Trace_Free();
+
+    if (!*Profile_GetTracePath())
+        return true;
+
+    if (!(g_trace.copy = SDL_malloc(TRACE_RING_SIZE * sizeof(trace_event_t))))
+        return SDL_SetError("failed to allocate trace buffer");
+
+    g_trace.enabled = true;
+    SDL_Log("Tracing to \"%s\" (written on exit and by the trace binding)", Profile_GetTracePath());
+    return true;
+}
+
+void Trace_Free(void)
+{
+    // Every thread that recorded events must have exited by now except the calling one.
+    if (g_trace.enabled)
+        Trace_Dump();
+
+    for (int i = 0; i < TRACE_MAX_THREADS; i++)
+        SDL_free(g_trace.threads[i]);
+
+    SDL_free(g_trace.copy);
+    SDL_memset(&g_trace, 0, sizeof(g_trace));
+}
+
+bool Trace_Dump(void)
+{
+    if (!g_trace.enabled)
+        return SDL_SetError("tracing is disabled");
+
+    Uint64 t0 = SDL_GetTicksNS();
+    const char *path = Profile_GetTracePath();
+
+    SDL_IOStream *io = SDL_IOFromFile(path, "w");
+    if (!io)
+        return false;
+
+    SDL_IOprintf(io, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    const char *sep = "\n";
+    size_t written = 0;
+    int count = SDL_min(SDL_GetAtomicInt(&g_trace.thread_count), TRACE_MAX_THREADS);
+    for (int i = 0; i < count; i++)
+    {
+        trace_thread_t *t = SDL_GetAtomicPointer(&g_trace.threads[i]);
+        if (!t) continue;
+
+        // The owner keeps recording while the ring is copied, whatever it overwrote in the
+        // meantime (including the slot it may be writing right now) is dropped afterwards.
+        Uint32 end = SDL_GetAtomicU32(&t->head);
+        Uint32 begin = end - SDL_min(end, TRACE_RING_SIZE);
+        for (Uint32 j = begin; j != end; j++)
+            g_trace.copy[j & TRACE_RING_MASK] = t->events[j & TRACE_RING_MASK];
+
+        Uint32 head = SDL_GetAtomicU32(&t->head);
+        if (head - begin >= TRACE_RING_SIZE)
+            begin = head - TRACE_RING_SIZE + 1;
+
+        unsigned int tid = i + 1;
+        SDL_IOprintf(io, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", sep, tid, (t->name) ? (t->name) : ("thread"));
+        sep = ",\n";
+
+        for (Uint32 j = begin; (Sint32)(end - j) > 0; j++)
+        {
+            const trace_event_t *e = &g_trace.copy[j & TRACE_RING_MASK];
+            SDL_IOprintf(io, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u", sep, e->name, e->phase, tid, (unsigned long long)(e->time / 1000), (unsigned int)(e->time % 1000));
+            if (e->has_arg) SDL_IOprintf(io, ",\"args\":{\"arg\":%u}", e->arg);
+            SDL_IOprintf(io, "}");
+            written++;
+        }
+    }
+
+    SDL_IOprintf(io, "\n]}\n");
+    if (!SDL_CloseIO(io))
+        return false;
+
+    SDL_Log("Wrote %zu trace events to \"%s\" in %.2f ms", written, path, (SDL_GetTicksNS() - t0) / 1e6);
+    return true;
+}
+
+void Trace_NameThread(const char *name)
+{
+    trace_thread_t *t = (g_trace.enabled) ? (Trace_GetThread()) : (0);
+    if (t) t->name = name;
+}
+
+void Trace_Begin(const char *name)
+{
+    Trace_Record(name, 'B', 0, false);
+}
+
+void Trace_BeginArg(const char *name, Uint32 arg)
+{
+    Trace_Record(name, 'B', arg, true);
+}
+
+void Trace_End(const char *name)
+{
+    Trace_Record(name, 'E', 0, false);
+}
+
+trace_thread_t *Trace_GetThread(void)
+{
+    trace_thread_t *t = SDL_GetTLS(&g_trace.tls);
+    if (t)
+        return t;
+
+    int idx;
+    do
+    {
+        idx = SDL_GetAtomicInt(&g_trace.thread_count);
+        if (idx >= TRACE_MAX_THREADS) return 0;
+    }
+    while (!SDL_CompareAndSwapAtomicInt(&g_trace.thread_count, idx, idx + 1));
+
+    if (!(t = SDL_calloc(1, sizeof(trace_thread_t))))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to allocate trace ring for thread %d", idx + 1);
+        return 0;
+    }
+
+    SDL_SetAtomicPointer(&g_trace.threads[idx], t);
+    SDL_SetTLS(&g_trace.tls, t, 0);
+    return t;
+}
+
+void Trace_Record(const char *name, char phase, Uint32 arg, bool has_arg)
+{
+    if (!g_trace.enabled)
+        return;
+
+    trace_thread_t *t = Trace_GetThread();
+    if (!t)
+        return;
+
+    Uint32 head = SDL_GetAtomicU32(&t->head);
+    t->events[head & TRACE_RING_MASK] = (trace_event_t){ name, SDL_GetTicksNS(), arg, phase, has_arg };
+    SDL_SetAtomicU32(&t->head, head + 1);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+bool Trace_Init(void);
+void Trace_Free(void);
+bool Trace_Dump(void);
+
+// Names have to be string literals, only the pointers are recorded.
+void Trace_NameThread(const char *name);
+void Trace_Begin(const char *name);
+void Trace_BeginArg(const char *name, Uint32 arg);
+void Trace_End(const char *name);